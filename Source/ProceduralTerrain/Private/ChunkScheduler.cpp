@@ -0,0 +1,120 @@
+#include "ChunkScheduler.h"
+#include "EndlessTerrain.h"
+
+void FAsyncChunkGenerator::DoWork()
+{
+	FTerrainChunk* ChunkPtr = ParentTerrain->ChunkPool.Pin(Chunk);
+	if (!ChunkPtr) {
+		return;
+	}
+	bCompleted = ChunkPtr->CreateResources(ParentTerrain, *BakedParams, bCancelled);
+	ChunkPtr->PublishCpuMemory();
+	// A cancelled job can still have produced the texture
+	if (ChunkPtr->IsReadyToUploadMesh() || ChunkPtr->IsReadyToUploadTexture()) {
+		ParentTerrain->CompletedChunks.Enqueue(Chunk);
+	}
+	ParentTerrain->ChunkPool.Unpin(Chunk);
+}
+
+FChunkGenerationScheduler::FChunkGenerationScheduler(AEndlessTerrain* Terrain)
+	: Terrain(Terrain)
+	, OriginChunkCoord(0, 0)
+{
+}
+
+FChunkGenerationScheduler::~FChunkGenerationScheduler() {
+	CancelAll();
+}
+
+void FChunkGenerationScheduler::Enqueue(FChunkKey Key) {
+	FTerrainChunk* ChunkPtr = Terrain->FindChunk(Key);
+	check(ChunkPtr && (ChunkPtr->GetState() == EChunkState::Empty || ChunkPtr->GetState() == EChunkState::Generated));
+
+	ChunkPtr->SetState(EChunkState::Queued);
+	ChunkPtr->MarkRequested();
+	Queue.HeapPush(FQueuedJob{ Key, PriorityOf(Key) }, FQueuedJobPredicate());
+}
+
+void FChunkGenerationScheduler::Update(FIntPoint NewOriginChunkCoord, int Range, int MaxConcurrentJobs) {
+	ReapFinishedJobs();
+
+	if (NewOriginChunkCoord != OriginChunkCoord) {
+		OriginChunkCoord = NewOriginChunkCoord;
+
+		for (int I = Queue.Num() - 1; I >= 0; --I) {
+			if (!IsInRange(Queue[I].Key, Range)) {
+				FTerrainChunk* ChunkPtr = Terrain->FindChunk(Queue[I].Key);
+				ChunkPtr->SetState(ChunkPtr->HasHeightField() ? EChunkState::Generated : EChunkState::Empty);
+				Queue.RemoveAtSwap(I, 1, false);
+			}
+			else {
+				Queue[I].Priority = PriorityOf(Queue[I].Key);
+			}
+		}
+		Queue.Heapify(FQueuedJobPredicate());
+
+		for (const FInFlightJob& Job : InFlight) {
+			if (!IsInRange(Job.Key, Range)) {
+				// Jobs still waiting in the pool are pulled back, running ones bail out at their next stage
+				Job.Task->GetTask().bCancelled.AtomicSet(true);
+				Job.Task->Cancel();
+			}
+		}
+	}
+
+	while (InFlight.Num() < MaxConcurrentJobs && Queue.Num() > 0) {
+		FQueuedJob Job;
+		Queue.HeapPop(Job, FQueuedJobPredicate(), false);
+
+		const FChunkHandle Chunk = Terrain->TerrainMap[Job.Key];
+		Terrain->ChunkPool.Get(Chunk)->SetState(EChunkState::Generating);
+
+		auto GenTask = new FAsyncTask<FAsyncChunkGenerator>(Chunk, Terrain, Terrain->BakedParams);
+		GenTask->StartBackgroundTask();
+		InFlight.Add(FInFlightJob{ Job.Key, Chunk, GenTask });
+	}
+}
+
+void FChunkGenerationScheduler::CancelAll() {
+	for (const FQueuedJob& Job : Queue) {
+		if (FTerrainChunk* ChunkPtr = Terrain->FindChunk(Job.Key)) {
+			ChunkPtr->SetState(ChunkPtr->HasHeightField() ? EChunkState::Generated : EChunkState::Empty);
+		}
+	}
+	Queue.Empty();
+
+	for (const FInFlightJob& Job : InFlight) {
+		Job.Task->GetTask().bCancelled.AtomicSet(true);
+		if (!Job.Task->Cancel()) {
+			Job.Task->EnsureCompletion(false);
+		}
+		FinishJob(Job);
+	}
+	InFlight.Empty();
+}
+
+int FChunkGenerationScheduler::PriorityOf(FChunkKey Key) const {
+	return Key.OffsetFrom(OriginChunkCoord).SizeSquared();
+}
+
+bool FChunkGenerationScheduler::IsInRange(FChunkKey Key, int Range) const {
+	// Coarser levels reach further out, see `AEndlessTerrain::CollectClipmapRing`
+	return Key.OffsetFrom(OriginChunkCoord).GetMax() <= Range * Key.Stride();
+}
+
+void FChunkGenerationScheduler::ReapFinishedJobs() {
+	for (int I = InFlight.Num() - 1; I >= 0; --I) {
+		if (InFlight[I].Task->IsDone()) {
+			FinishJob(InFlight[I]);
+			InFlight.RemoveAtSwap(I, 1, false);
+		}
+	}
+}
+
+void FChunkGenerationScheduler::FinishJob(const FInFlightJob& Job) {
+	if (FTerrainChunk* ChunkPtr = Terrain->ChunkPool.Get(Job.Chunk)) {
+		// A cancelled remesh keeps the previous mesh
+		ChunkPtr->SetState(Job.Task->GetTask().bCompleted || ChunkPtr->HasHeightField() ? EChunkState::Generated : EChunkState::Empty);
+	}
+	delete Job.Task;
+}
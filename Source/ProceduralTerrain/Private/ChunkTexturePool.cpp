@@ -0,0 +1,67 @@
+#include "ChunkTexturePool.h"
+#include "RenderingThread.h"
+#include "TextureResource.h"
+
+void FChunkTexturePool::Init(int InWidth, int InHeight, EPixelFormat InFormat, int NumSlices) {
+	Width = InWidth;
+	Height = InHeight;
+	Format = InFormat;
+
+	Array = UTexture2DArray::CreateTransient(Width, Height, NumSlices, Format);
+	check(Array);
+	Array->Filter = TextureFilter::TF_Nearest;
+	Array->AddressX = TextureAddress::TA_Clamp;
+	Array->AddressY = TextureAddress::TA_Clamp;
+	// Single channel textures hold palette indices, which have to reach the material unchanged
+	Array->SRGB = Format != PF_G8;
+	Array->UpdateResource();
+
+	FreeSlices.Reset(NumSlices);
+	for (int Slice = NumSlices - 1; Slice >= 0; --Slice) {
+		FreeSlices.Add(Slice);
+	}
+}
+
+int FChunkTexturePool::AcquireSlice() {
+	if (FreeSlices.Num() == 0) {
+		return INDEX_NONE;
+	}
+	++AllocationsInWindow;
+	return FreeSlices.Pop(false);
+}
+
+void FChunkTexturePool::ReleaseSlice(int Slice) {
+	check(Slice != INDEX_NONE && !FreeSlices.Contains(Slice));
+	FreeSlices.Add(Slice);
+}
+
+void FChunkTexturePool::Upload(int Slice, TArray<uint8>&& Data) {
+	const int BytesPerPixel = GPixelFormats[Format].BlockBytes;
+	const int SrcPitch = Width * BytesPerPixel;
+	check(Data.Num() == SrcPitch * Height);
+	UploadBytesThisFrame += Data.Num();
+
+	FTextureResource* Resource = Array->GetResource();
+	ENQUEUE_RENDER_COMMAND(UploadChunkTextureSlice)(
+		[Resource, Slice, SrcPitch, Rows = Height, Data = MoveTemp(Data)](FRHICommandListImmediate& RHICmdList) {
+			uint32 DestStride = 0;
+			uint8* Dest = static_cast<uint8*>(RHICmdList.LockTexture2DArray(Resource->TextureRHI, Slice, 0, RLM_WriteOnly, DestStride, false));
+			for (int Row = 0; Row < Rows; ++Row) {
+				FMemory::Memcpy(Dest + Row * DestStride, Data.GetData() + Row * SrcPitch, SrcPitch);
+			}
+			RHICmdList.UnlockTexture2DArray(Resource->TextureRHI, Slice, 0, false);
+		}
+	);
+}
+
+void FChunkTexturePool::Tick(float DeltaTime) {
+	UploadBytesLastFrame = UploadBytesThisFrame;
+	UploadBytesThisFrame = 0;
+
+	AllocationWindowSeconds += DeltaTime;
+	if (AllocationWindowSeconds >= 1.) {
+		AllocationsPerSecond = AllocationsInWindow / AllocationWindowSeconds;
+		AllocationsInWindow = 0;
+		AllocationWindowSeconds = 0.;
+	}
+}
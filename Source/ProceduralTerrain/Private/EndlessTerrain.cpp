@@ -1,225 +1,483 @@
-// TODO: Maybe theres a smarter way to hanbdle the water that does not involve all these sub-meshes,
-
 #include "EndlessTerrain.h"
+#include "TerrainMeshing.h"
+#include "TerrainPipeline.h"
+#include "TerrainStats.h"
+#include "Hash/CityHash.h"
+#include "Algo/AllOf.h"
+#include "Algo/AnyOf.h"
+#include "EngineUtils.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
 
 #define DEBUG_DRAW false
 
-FTerrainChunk::FTerrainChunk(AEndlessTerrain* ParentTerrain, FIntPoint ChunkCoord, float  Size)
-	: MapLod(EMapLod::One)
-	, ChunkCoord(ChunkCoord)
+namespace {
+	const TCHAR* ChunkStateToString(EChunkState State) {
+		switch (State) {
+			case EChunkState::Empty: return TEXT("Empty");
+			case EChunkState::Queued: return TEXT("Queued");
+			case EChunkState::Generating: return TEXT("Generating");
+			case EChunkState::Generated: return TEXT("Generated");
+			default: return TEXT("Unknown");
+		}
+	}
+
+	int FloorDiv(int A, int B) {
+		return A >= 0 ? A / B : -((B - 1 - A) / B);
+	}
+
+	// One quad over [Min, Max], UVs repeat once per level 0 chunk like the per chunk quads did
+	void AddWaterQuad(FVector2D Min, FVector2D Max, FVector2D UvSize, TArray<FVector>& Vertices, TArray<FVector2D>& Uv0, TArray<int32>& Triangles) {
+		const int32 First = Vertices.Num();
+		Vertices.Add(FVector(Min.X, Min.Y, 0));
+		Vertices.Add(FVector(Max.X, Min.Y, 0));
+		Vertices.Add(FVector(Min.X, Max.Y, 0));
+		Vertices.Add(FVector(Max.X, Max.Y, 0));
+		Uv0.Add(FVector2D(0., 0.));
+		Uv0.Add(FVector2D(UvSize.X, 0.));
+		Uv0.Add(FVector2D(0., UvSize.Y));
+		Uv0.Add(UvSize);
+		Triangles.Append({ First + 2, First + 1, First, First + 3, First + 1, First + 2 });
+	}
+
+	void WriteHistogramCsv(const TCHAR* Name, const FHistogram& Histogram, FString& Out) {
+		for (int Bin = 0; Bin < Histogram.GetNumBins(); ++Bin) {
+			Out += FString::Printf(TEXT("%s,%.1f,%.1f,%d\n"), Name, Histogram.GetBinLowerBound(Bin), Histogram.GetBinUpperBound(Bin), Histogram.GetBinObservationsCount(Bin));
+		}
+	}
+
+	FAutoConsoleCommandWithWorld DumpChunkMemoryCommand(
+		TEXT("Terrain.DumpChunkMemory"),
+		TEXT("Logs retained CPU and estimated GPU memory of every resident endless terrain chunk"),
+		FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World) {
+			for (TActorIterator<AEndlessTerrain> It(World); It; ++It) {
+				It->DumpChunkMemory();
+			}
+		})
+	);
+
+	FAutoConsoleCommandWithWorld DumpLatencyCommand(
+		TEXT("Terrain.DumpLatency"),
+		TEXT("Logs the chunk visible and remesh latency histograms of every endless terrain"),
+		FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World) {
+			for (TActorIterator<AEndlessTerrain> It(World); It; ++It) {
+				It->DumpLatency();
+			}
+		})
+	);
+
+	FAutoConsoleCommandWithWorldAndArgs ExportLatencyCsvCommand(
+		TEXT("Terrain.ExportLatencyCsv"),
+		TEXT("Terrain.ExportLatencyCsv [Path] writes the latency histograms as CSV, to Profiling/TerrainLatency.csv by default"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World) {
+			const FString Path = Args.Num() > 0 ? Args[0] : FPaths::Combine(FPaths::ProfilingDir(), TEXT("TerrainLatency.csv"));
+			for (TActorIterator<AEndlessTerrain> It(World); It; ++It) {
+				if (It->ExportLatencyCsv(Path)) {
+					UE_LOG(LogProceduralTerrain, Display, TEXT("Wrote %s"), *Path);
+				}
+				else {
+					UE_LOG(LogProceduralTerrain, Warning, TEXT("Could not write %s"), *Path);
+				}
+				// Several terrains would overwrite each other's file
+				break;
+			}
+		})
+	);
+
+	FAutoConsoleCommandWithWorld ResetLatencyCommand(
+		TEXT("Terrain.ResetLatency"),
+		TEXT("Clears the latency histograms of every endless terrain"),
+		FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World) {
+			for (TActorIterator<AEndlessTerrain> It(World); It; ++It) {
+				It->ResetLatency();
+			}
+		})
+	);
+}
+
+FTerrainChunk::FTerrainChunk(AEndlessTerrain* ParentTerrain, FChunkKey InKey)
+	: DesiredLod(EMapLod::One)
+	, MeshLod(EMapLod::One)
+	, Key(InKey)
+	, Rect(AEndlessTerrain::ChunkRect(InKey))
 {
-	FVector2D Center = ChunkCoord * Size;
-	const float HalfSize = (float)Size / 2.;
+	MeshComponent = ParentTerrain->AllocateSection(Key, SectionIndex);
+	// The caller makes sure there is a free slice
+	TextureSlice = ParentTerrain->TexturePool.AcquireSlice();
+	check(TextureSlice != INDEX_NONE);
+}
+
+bool FTerrainChunk::CreateResources(AEndlessTerrain* ParentTerrain, const FChunkBakedParams& Params, const FThreadSafeBool& bCancelled) {
+	if (bCancelled) {
+		return false;
+	}
 
-	Rect = FBox2D(Center - HalfSize, Center + HalfSize);
-	SectionIndex = ParentTerrain->CurrSectionIndex();	
+	// A chunk generated from scratch never materializes its float heights, every sample goes through noise,
+	// texel and vertex in one pass
+	if (!DEBUG_DRAW && HeightField.IsEmpty() && !bHasTexture && !LoadHeightField(Params, Key, HeightField, Apron)) {
+		GenerateFused(Params);
+		bHasTexture = true;
+		ReadyToUploadTexture.AtomicSet(true);
+		if (bCancelled) {
+			// The next job rebuilds the mesh from the heightfield
+			Vertices.Empty();
+			Uv0.Empty();
+			return false;
+		}
+		CreateNormals(Params);
+		StageMesh();
+		return true;
+	}
 
-	MaterialInstance = UMaterialInstanceDynamic::Create(ParentTerrain->Material, ParentTerrain->Mesh);
-	check(MaterialInstance);
-	ParentTerrain->Mesh->SetMaterial(SectionIndex, MaterialInstance);
-	ParentTerrain->WaterMesh->SetMaterial(SectionIndex, ParentTerrain->WaterMaterial);
+	// Float heights only live for the duration of the job, the chunk keeps the quantized heightfield
+	TArray<float> Heights;
+	if (HeightField.IsEmpty()) {
+		BuildHeights(Params, Key, HeightField, Apron, Heights);
+	}
+	else {
+		HeightField.Dequantize(Heights);
+	}
+
+	if (!bHasTexture) {
+		UpdateTexture(Heights, Params);
+		bHasTexture = true;
+		ReadyToUploadTexture.AtomicSet(true);
+	}
+	if (bCancelled) {
+		return false;
+	}
+	CreateMesh(Heights, Params);
+	CreateNormals(Params);
+	StageMesh();
+	return true;
 }
 
-void FTerrainChunk::CreateResources(AEndlessTerrain* ParentTerrain) {
-	UpdateTexture(ParentTerrain);
-	ReadyToUploadTexture.AtomicSet(true);
-	CreateMesh(ParentTerrain);
+void FTerrainChunk::StageMesh() {
+	// Only now, a cancelled job must not leave `MeshLod` claiming a mesh that was never staged
+	MeshLod = DesiredLod;
 	ReadyToUploadMesh.AtomicSet(true);
 }
 
-void FTerrainChunk::CreateMesh(AEndlessTerrain* ParentTerrain) {
-	const FVector2D Center = Rect.GetCenter();
-	const float HalfSize = Rect.GetSize().X / 2.;
-	check(Rect.GetSize().X == Rect.GetSize().Y);
-
-	const float XOffset = -HalfSize;
-	const float YOffset = -HalfSize;
-	const float ZOffset = 0.0;
+bool FTerrainChunk::LoadHeightField(const FChunkBakedParams& Params, FChunkKey Key, FQuantizedHeightfield& OutHeightField, FQuantizedApron& OutApron) {
+	if (Key.Level != 0) {
+		return false;
+	}
+	return (Params.BakedWorld && Params.BakedWorld->ReadHeightField(Key.Coord, OutHeightField, OutApron))
+		|| (Params.TileCache && Params.TileCache->Load(Key.Coord, OutHeightField, OutApron));
+}
 
-	const int Width = AEndlessTerrain::VerticesInChunk;
-	const int Height = AEndlessTerrain::VerticesInChunk;
+void FTerrainChunk::BuildHeights(const FChunkBakedParams& Params, FChunkKey Key, FQuantizedHeightfield& OutHeightField, FQuantizedApron& OutApron, TArray<float>& OutHeights) {
+	if (LoadHeightField(Params, Key, OutHeightField, OutApron)) {
+		OutHeightField.Dequantize(OutHeights);
+		return;
+	}
 
-	for (int Y = 0; Y < Height; ++Y) {
-		for (int X = 0; X < Width; ++X) {
-			// TODO: Duplicated code here, think about it soon, maybe save normalized noise instead of absolute
-			const int NoiseIndex = Y * Width + X;
-			const float NoiseValue = Noise.NoiseValues[NoiseIndex];
-
-			const float XPos = X * AEndlessTerrain::TileSize;
-			const float YPos = Y * AEndlessTerrain::TileSize;
-			float MultiplierEffectiveness = 1.0;
-			if (IsValid(ParentTerrain->ElevationCurve)) {
-				MultiplierEffectiveness = ParentTerrain->ElevationCurve->GetFloatValue(NoiseValue);
-			}
-			Vertices.Add(FVector(Center.X + XPos + XOffset, Center.Y + YPos + YOffset, ZOffset + MultiplierEffectiveness * ParentTerrain->ElevationMultiplier));
-
-			const float U = (float)X / Width;
-			const float V = (float)Y / Width;
-			Uv0.Add(FVector2D(U, V));
-		}
-	}
-
-	
-	const int StepSize = static_cast<int>(MapLod);
-	const int XStepOffset = StepSize;
-	const int YStepOffset = Width * StepSize;
-
-	for (int Y = 0; Y < Height; Y += StepSize) {
-		for (int X = 0; X < Width; X += StepSize) {
-			if (Y < (Height - StepSize) && X < (Width - StepSize)) {
-				const int CurrentIndex = Y * Width + X;
-				// Vertex setup
-				//   0      1      2      3    ..    W-1
-				// (0+W)  (1+W)  (2+W)  (3+W)  .. (2W - 1)
-				// ...
-
-				// Both triangles need to have counter-clockwise winding-order
-				//     X
-				//     |\
-				//     | \
-				// X+W --- x+W+1
-				Triangles.Add(CurrentIndex);
-				Triangles.Add(CurrentIndex + YStepOffset);
-				Triangles.Add(CurrentIndex + YStepOffset + XStepOffset);
-
-				// X --- X+1    
-				//   \ |
-				//    \|
-				//     X+W+1
-				Triangles.Add(CurrentIndex);
-				Triangles.Add(CurrentIndex + YStepOffset + XStepOffset);
-				Triangles.Add(CurrentIndex + XStepOffset);
-			}
-		}
+	TERRAIN_SCOPED_STAT(Noise);
+	NoiseMap Noise;
+	if (Params.NoiseGraph) {
+		Noise.Init(
+			ENormalizeMode::Global,
+			*Params.NoiseGraph,
+			Params.RandomSeed,
+			AEndlessTerrain::VerticesInChunk,
+			AEndlessTerrain::VerticesInChunk,
+			Params.Scale,
+			AEndlessTerrain::ChunkNoiseOffset(Key),
+			Params.NoiseThreading,
+			Key.Stride()
+		);
 	}
+	else {
+		Noise.Init(
+			ENormalizeMode::Global,
+			Params.RandomSeed,
+			AEndlessTerrain::VerticesInChunk,
+			AEndlessTerrain::VerticesInChunk,
+			Params.Scale,
+			Params.Octaves,
+			Params.Persistance,
+			Params.Lacunarity,
+			AEndlessTerrain::ChunkNoiseOffset(Key),
+			Params.NoiseThreading,
+			Params.NoiseBackend,
+			Key.Stride()
+		);
+	}
+	OutHeightField.Quantize(Noise.NoiseValues, Noise.Width, Noise.Height, NoiseMap::NormalizedRange(ENormalizeMode::Global));
+	OutHeights = MoveTemp(Noise.NoiseValues);
+	TerrainPipeline::BuildApron(NoiseDesc(Params, Key), OutHeightField, OutApron);
 
-	UE_LOG(LogTemp, Display, TEXT("Updated Mesh Data at: (%d, %d)"), ChunkCoord.X, ChunkCoord.Y);
+	if (Params.TileCache && Key.Level == 0) {
+		Params.TileCache->Store(Key.Coord, OutHeightField, OutApron);
+	}
 }
 
-void FTerrainChunk::UpdateTexture(AEndlessTerrain* ParentTerrain) {
-	Noise.Init(
-		ENormalizeMode::Global,
-		ParentTerrain->RandomSeed,
+FTerrainGrid FTerrainChunk::MeshGrid() const {
+	check(Rect.GetSize().X == Rect.GetSize().Y);
+
+	return FTerrainGrid{
 		AEndlessTerrain::VerticesInChunk,
 		AEndlessTerrain::VerticesInChunk,
-		ParentTerrain->Scale,
-		ParentTerrain->Octaves,
-		ParentTerrain->Persistance,
-		ParentTerrain->Lacunarity,
-		ChunkCoord * (AEndlessTerrain::VerticesInChunk - 1)
-	);
+		static_cast<int>(DesiredLod),
+		AEndlessTerrain::TileSize * Key.Stride(),
+		FVector(Rect.Min.X, Rect.Min.Y, 0.0)
+	};
+}
 
-	const int Width = AEndlessTerrain::VerticesInChunk;
-	const int Height = AEndlessTerrain::VerticesInChunk;
+FChunkPipelineDesc FTerrainChunk::NoiseDesc(const FChunkBakedParams& Params, FChunkKey Key) {
+	FChunkPipelineDesc Desc;
+	Desc.NormalizeMode = ENormalizeMode::Global;
+	Desc.Seed = Params.RandomSeed;
+	Desc.Scale = Params.Scale;
+	Desc.Octaves = Params.Octaves;
+	Desc.Persistance = Params.Persistance;
+	Desc.Lacunarity = Params.Lacunarity;
+	Desc.NoiseOffset = AEndlessTerrain::ChunkNoiseOffset(Key);
+	Desc.SampleSpacing = Key.Stride();
+	Desc.Threading = Params.NoiseThreading;
+	Desc.Backend = Params.NoiseBackend;
+	Desc.Graph = Params.NoiseGraph.Get();
+	Desc.Grid = FTerrainGrid{ AEndlessTerrain::VerticesInChunk, AEndlessTerrain::VerticesInChunk, 1, AEndlessTerrain::TileSize * Key.Stride(), FVector(0.) };
+	return Desc;
+}
 
-	const int PixelSize = 4;
-	TextureData.SetNum(Width * Height * PixelSize);
-	for (int Y = 0; Y < Height; ++Y) {
-		for (int X = 0; X < Width; ++X) {
-			const int NoiseIndex = Y * Width + X;
-			const float NoiseValue = Noise.NoiseValues[NoiseIndex];
+FChunkPipelineDesc FTerrainChunk::PipelineDesc(const FChunkBakedParams& Params) const {
+	FChunkPipelineDesc Desc = NoiseDesc(Params, Key);
+	Desc.Grid = MeshGrid();
+	Desc.Elevation = &Params.Elevation;
+	Desc.Classifier = &Params.Classifier;
+	Desc.Texels = Params.TextureFormat == ETerrainTextureFormat::PaletteIndex ? EPipelineTexels::PaletteIndex : EPipelineTexels::Color;
+	return Desc;
+}
 
-			const int TextureIndex = NoiseIndex * PixelSize;
+void FTerrainChunk::GenerateFused(const FChunkBakedParams& Params) {
+	TERRAIN_SCOPED_STAT(FusedGeneration);
 
-			for (const FTerrainParams& Param : ParentTerrain->TerrainParams) {
-				if (NoiseValue <= Param.MaxHeight) {
-					const FColor Color = Param.Color;
+	FChunkPipelineOutput Output;
+	const FChunkPipelineDesc Desc = PipelineDesc(Params);
+	TerrainPipeline::BuildChunk(Desc, Output);
+	HeightField = MoveTemp(Output.HeightField);
+	TextureData = MoveTemp(Output.Texels);
+	Vertices = MoveTemp(Output.Vertices);
+	Uv0 = MoveTemp(Output.Uv0);
+	bHasWater = Output.bHasWater;
+	TerrainPipeline::BuildApron(Desc, HeightField, Apron);
+
+	if (Params.TileCache && Key.Level == 0) {
+		Params.TileCache->Store(Key.Coord, HeightField, Apron);
+	}
+	UE_LOG(LogProceduralTerrain, Verbose, TEXT("Generated Chunk at: (%d, %d) level %d"), Key.Coord.X, Key.Coord.Y, Key.Level);
+}
 
-					TextureData[TextureIndex] = Color.B;
-					TextureData[TextureIndex + 1] = Color.G;
-					TextureData[TextureIndex + 2] = Color.R;
-					TextureData[TextureIndex + 3] = 255;
+void FTerrainChunk::Bake(const FChunkBakedParams& Params, FIntPoint ChunkCoord, TArrayView<const int> LodSteps, bool bWriteClasses, FBakedChunk& OutChunk) {
+	TArray<float> Heights;
+	BuildHeights(Params, ChunkCoord, OutChunk.HeightField, OutChunk.Apron, Heights);
 
-					break;
-				}
-			}
+	if (bWriteClasses) {
+		OutChunk.Classes.SetNumUninitialized(Heights.Num());
+		TerrainTexturing::WriteIndices(Heights, Params.Classifier, OutChunk.Classes.GetData());
+	}
+	else {
+		OutChunk.Classes.Reset();
+	}
+
+	OutChunk.LodElevations.SetNum(LodSteps.Num());
+	for (int LodIndex = 0; LodIndex < LodSteps.Num(); ++LodIndex) {
+		const FTerrainGrid Grid{ AEndlessTerrain::VerticesInChunk, AEndlessTerrain::VerticesInChunk, LodSteps[LodIndex], AEndlessTerrain::TileSize, FVector(0.) };
+		TerrainMeshing::BuildElevations(Grid, Heights, Params.Elevation, OutChunk.LodElevations[LodIndex]);
+	}
+}
+
+void FTerrainChunk::CreateMesh(TArrayView<const float> Heights, const FChunkBakedParams& Params) {
+	TERRAIN_SCOPED_STAT(Meshing);
+	const FTerrainGrid Grid = MeshGrid();
+
+	TArray<float> Elevations;
+	if (Params.bUseBakedElevations && Key.Level == 0 && Params.BakedWorld->ReadLodElevations(Key.Coord, Grid.StepSize, Elevations)) {
+		TerrainMeshing::BuildVerticesFromElevations(Grid, Elevations, Vertices, Uv0);
+	}
+	else {
+		TerrainMeshing::BuildVertices(Grid, Heights, Params.Elevation, Vertices, Uv0);
+	}
+
+	UE_LOG(LogProceduralTerrain, Verbose, TEXT("Updated Mesh Data at: (%d, %d) level %d"), Key.Coord.X, Key.Coord.Y, Key.Level);
+}
+
+void FTerrainChunk::CreateNormals(const FChunkBakedParams& Params) {
+	TERRAIN_SCOPED_STAT(Normals);
+	// The apron came from the noise function rather than the neighbors, which may not even exist yet
+	FHeightApron HeightApron;
+	Apron.Dequantize(HeightField, HeightApron);
+
+	TArray<FVector> TangentsX;
+	TerrainMeshing::BuildNormals(MeshGrid(), HeightField, HeightApron, Params.Elevation, Normals, TangentsX);
+	Tangents.SetNumUninitialized(TangentsX.Num());
+	for (int I = 0; I < TangentsX.Num(); ++I) {
+		Tangents[I] = FProcMeshTangent(TangentsX[I], false);
+	}
+}
+
+void FTerrainChunk::UpdateTexture(TArrayView<const float> Heights, const FChunkBakedParams& Params) {
+	TERRAIN_SCOPED_STAT(Classification);
+	const int Width = AEndlessTerrain::VerticesInChunk;
+	const int Height = AEndlessTerrain::VerticesInChunk;
+
+	TArray<uint8> Classes;
+	if (Params.bUseBakedClasses && Key.Level == 0 && Params.BakedWorld->ReadClasses(Key.Coord, Classes)) {
+		if (Params.TextureFormat == ETerrainTextureFormat::PaletteIndex) {
+			bHasWater = TerrainTexturing::HasWater(Classes, Params.Classifier);
+			TextureData = MoveTemp(Classes);
+		}
+		else {
+			TextureData.SetNumUninitialized(Width * Height * TerrainTexturing::BytesPerTexel);
+			bHasWater = TerrainTexturing::WriteColorsFromIndices(Classes, Params.Classifier, TextureData.GetData());
+		}
+	}
+	else if (Params.TextureFormat == ETerrainTextureFormat::PaletteIndex) {
+		TextureData.SetNumUninitialized(Width * Height * TerrainTexturing::BytesPerIndexTexel);
+		bHasWater = TerrainTexturing::WriteIndices(Heights, Params.Classifier, TextureData.GetData());
+	}
+	else {
+		TextureData.SetNumUninitialized(Width * Height * TerrainTexturing::BytesPerTexel);
+		bHasWater = TerrainTexturing::WriteColors(Heights, Params.Classifier, TextureData.GetData());
+	}
 #if DEBUG_DRAW
+	for (int Y = 0; Y < Height && Params.TextureFormat == ETerrainTextureFormat::Color; ++Y) {
+		for (int X = 0; X < Width; ++X) {
 			if (X == 0 || X == (Width - 1) || Y == 0 || Y == (Height - 1)) {
+				const int TextureIndex = (Y * Width + X) * TerrainTexturing::BytesPerTexel;
 				TextureData[TextureIndex] = 0;
 				TextureData[TextureIndex + 1] = 0;
 				TextureData[TextureIndex + 2] = 255;
 				TextureData[TextureIndex + 3] = 255;
 			}
-#endif
 		}
 	}
-	UE_LOG(LogTemp, Display, TEXT("Updated Texture Data at: (%d, %d)"), ChunkCoord.X, ChunkCoord.Y);
+#endif
+	UE_LOG(LogProceduralTerrain, Verbose, TEXT("Updated Texture Data at: (%d, %d) level %d"), Key.Coord.X, Key.Coord.Y, Key.Level);
 }
 
 void FTerrainChunk::UploadTexture(AEndlessTerrain* ParentTerrain) {
-	const int Width = AEndlessTerrain::VerticesInChunk;
-	const int Height = AEndlessTerrain::VerticesInChunk;
+	TERRAIN_SCOPED_STAT(TextureUpload);
+	UploadedTextureBytes = TextureData.Num();
+	// Moved to the render thread, rebuilt from `HeightField` if it's ever needed again
+	ParentTerrain->TexturePool.Upload(TextureSlice, MoveTemp(TextureData));
 
-	const FName TextureName = FName(TEXT("NoiseTexture%d"), SectionIndex);
-	Texture = UTexture2D::CreateTransient(Width, Height, PF_B8G8R8A8, TextureName);
-	Texture->Filter = TextureFilter::TF_Nearest;
-	Texture->AddressX = TextureAddress::TA_Clamp;
-	Texture->AddressY = TextureAddress::TA_Clamp;
-	check(Texture);
+	ReadyToUploadTexture.AtomicSet(false);
+	PublishCpuMemory();
+
+	UE_LOG(LogProceduralTerrain, Verbose, TEXT("Uploaded Texture Data at: (%d, %d) level %d"), Key.Coord.X, Key.Coord.Y, Key.Level);
+}
 
-	FTexture2DMipMap* MipMap = &Texture->GetPlatformData()->Mips[0];
-	FByteBulkData* ImageData = &MipMap->BulkData;
-	uint8* RawImageData = (uint8*)ImageData->Lock(LOCK_READ_WRITE);
-	for (int I = 0; I < TextureData.Num(); ++I) {
-		RawImageData[I] = TextureData[I];
+void FTerrainChunk::UploadMesh(AEndlessTerrain* ParentTerrain) {
+	TERRAIN_SCOPED_STAT(MeshUpload);
+	const TArray<int32>& Triangles = ParentTerrain->GetLodTriangles(MeshLod);
+	// Every vertex carries the chunk's slice of the shared texture array
+	TArray<FVector2D> Uv1;
+	Uv1.Init(FVector2D(TextureSlice, 0.), Vertices.Num());
+	MeshComponent->CreateMeshSection_LinearColor(SectionIndex, Vertices, Triangles, Normals, Uv0, Uv1, {}, {}, {}, Tangents, false);
+	if (!bVisible) {
+		// New sections start out visible, this one left the view distance while it was generating
+		MeshComponent->SetMeshSectionVisible(SectionIndex, false);
 	}
-	ImageData->Unlock();
-	Texture->UpdateResource();
+	UploadedMeshBytes = Vertices.Num() * sizeof(FProcMeshVertex) + Triangles.Num() * sizeof(uint32);
+	Vertices.Empty();
+	Uv0.Empty();
+	Normals.Empty();
+	Tangents.Empty();
 
-	MaterialInstance->SetTextureParameterValue("NoiseTexture", Texture);
+	ReadyToUploadMesh.AtomicSet(false);
+	PublishCpuMemory();
+
+	UE_LOG(LogProceduralTerrain, Verbose, TEXT("Uploaded Mesh Data at: (%d, %d) level %d"), Key.Coord.X, Key.Coord.Y, Key.Level);
+}
 
-	ReadyToUploadTexture.AtomicSet(false);
 
-	UE_LOG(LogTemp, Display, TEXT("Uploaded Texture Data at: (%d, %d)"), ChunkCoord.X, ChunkCoord.Y);
+void FTerrainChunk::SetVisible(AEndlessTerrain* ParentTerrain, bool bNewVisible) {
+	if (bVisible == bNewVisible) {
+		return;
+	}
+	bVisible = bNewVisible;
+	if (!bVisible) {
+		LastVisibleFrame = GFrameCounter;
+	}
+	MeshComponent->SetMeshSectionVisible(SectionIndex, bVisible);
+	if (HasWater()) {
+		ParentTerrain->MarkWaterDirty(Key);
+	}
 }
 
-void FTerrainChunk::UploadMesh(AEndlessTerrain* ParentTerrain) {
-	// TODO: Not using Normal values atm
-	ParentTerrain->Mesh->CreateMeshSection_LinearColor(SectionIndex, Vertices, Triangles, {}, Uv0, {}, {}, false);
-
-	const FVector2D Center = Rect.GetCenter();
-	const float HalfChunkSize = AEndlessTerrain::ChunkSize() / 2.;
-	TArray<FVector> WaterVertices = {
-		FVector(Center.X - HalfChunkSize, Center.Y - HalfChunkSize, 0),
-		FVector(Center.X + HalfChunkSize, Center.Y - HalfChunkSize, 0),
-		FVector(Center.X - HalfChunkSize, Center.Y + HalfChunkSize, 0),
-		FVector(Center.X + HalfChunkSize, Center.Y + HalfChunkSize, 0)
-	};
-	TArray<FVector2D> WaterUv0 = { 
-		FVector2D(0., 0.),
-		FVector2D(1., 0.),
-		FVector2D(0., 1.),
-		FVector2D(1., 1.)
-	};
-	TArray<int32> WaterTriangles = {2, 1, 0, 3, 1, 2};
-	ParentTerrain->WaterMesh->CreateMeshSection_LinearColor(SectionIndex, WaterVertices, WaterTriangles, {}, WaterUv0, {}, {}, false);
+void FTerrainChunk::ReleaseResources(AEndlessTerrain* ParentTerrain) {
+	if (HasWater()) {
+		ParentTerrain->MarkWaterDirty(Key);
+	}
+	MeshComponent->ClearMeshSection(SectionIndex);
+	MeshComponent->SetMaterial(SectionIndex, nullptr);
 
-	ReadyToUploadMesh.AtomicSet(false);
+	ParentTerrain->TexturePool.ReleaseSlice(TextureSlice);
+	TextureSlice = INDEX_NONE;
 
-	UE_LOG(LogTemp, Display, TEXT("Uploaded Mesh Data at: (%d, %d)"), ChunkCoord.X, ChunkCoord.Y);
+	UploadedTextureBytes = 0;
+	UploadedMeshBytes = 0;
 }
 
-void FAsyncChunkGenerator::DoWork()
-{
-	Chunk->CreateResources(ParentTerrain);
+void FTerrainChunk::PublishCpuMemory() {
+	const SIZE_T Bytes = sizeof(FTerrainChunk)
+		+ HeightField.GetAllocatedSize()
+		+ Apron.GetAllocatedSize()
+		+ TextureData.GetAllocatedSize()
+		+ Vertices.GetAllocatedSize()
+		+ Uv0.GetAllocatedSize()
+		+ Normals.GetAllocatedSize()
+		+ Tangents.GetAllocatedSize();
+	CpuBytes.store(Bytes, std::memory_order_relaxed);
 }
 
+SIZE_T FTerrainChunk::GetGpuMemory() const {
+	return UploadedTextureBytes + UploadedMeshBytes;
+}
 
 AEndlessTerrain::AEndlessTerrain()
 	: Scale(60.)
 	, Octaves(1)
 	, Persistance(0.5)
 	, Lacunarity(1.0)
+	, NoiseBackend(ETerrainNoiseBackend::Perlin)
+	, bParallelNoise(true)
 	, ChunksInViewDistance(2)
+	, Layout(ETerrainLayout::Grid)
+	, ClipmapLevels(4)
+	, MaxConcurrentChunkJobs(4)
+	, QueuedChunkJobs(0)
+	, InFlightChunkJobs(0)
+	, UploadBudgetMs(2.)
+	, PendingChunkUploads(0)
+	, ActiveMeshShards(0)
+	, WaterSections(0)
+	, ChunkMemoryBudgetMB(512.)
+	, EvictionHysteresis(2)
+	, ResidentChunkMemoryMB(0.)
+	, MaxChunkTextures(128)
+	, TextureAllocationsPerSecond(0.)
+	, TextureUploadBytesLastFrame(0)
 	, Mesh(CreateDefaultSubobject<UProceduralMeshComponent>("EndlessMesh"))
 	, Material(CreateDefaultSubobject<UMaterial>("EndlessMaterial"))
-	, WaterMesh(CreateDefaultSubobject<UProceduralMeshComponent>("WaterMesh"))
+	, MaterialInstance(nullptr)
 	, WaterMaterial(CreateDefaultSubobject<UMaterial>("WaterMaterial"))
 	, TerrainParams(FTerrainParams::GetParams())
+	, TextureFormat(ETerrainTextureFormat::Color)
+	, PaletteTexture(nullptr)
 	, ElevationMultiplier(AEndlessTerrain::VerticesInChunk)
 	, ElevationCurve(CreateDefaultSubobject<UCurveFloat>("ElevationCurve"))
+	, ElevationLutResolution(FElevationLut::DefaultResolution)
+	, bUseTileCache(true)
+	, TileCacheSizeMB(1024.)
+	, TileCacheHits(0)
+	, TileCacheMisses(0)
 	, RandomSeed(0)
 	, RandomStream(FRandomStream(RandomSeed))
+	, Scheduler(this)
 {
 	check(Mesh);
 	check(Material);
@@ -227,6 +485,7 @@ AEndlessTerrain::AEndlessTerrain()
 	RootComponent = Mesh;
 
 	PrimaryActorTick.bCanEverTick = true;
+	ResetLatency();
 }
 
 AEndlessTerrain::~AEndlessTerrain()
@@ -235,14 +494,188 @@ AEndlessTerrain::~AEndlessTerrain()
 
 void AEndlessTerrain::OnConstruction(const FTransform& Transform) {
 	Super::OnConstruction(Transform);
+	BakeParams();
 	UpdateVisibleChunks();
 }
 
-int AEndlessTerrain::CurrSectionIndex() const {
-	return TerrainMap.Num();
+void AEndlessTerrain::FillBakedParams(FChunkBakedParams& Params) const {
+	const FFloatInterval HeightRange = NoiseMap::NormalizedRange(ENormalizeMode::Global);
+	Params.RandomSeed = RandomSeed;
+	Params.Scale = Scale;
+	Params.Octaves = Octaves;
+	Params.Persistance = Persistance;
+	Params.Lacunarity = Lacunarity;
+	Params.NoiseThreading = bParallelNoise ? ENoiseThreading::Parallel : ENoiseThreading::Serial;
+	Params.NoiseBackend = ToNoiseBackend(NoiseBackend);
+	FString GraphError;
+	Params.NoiseGraph = BakeNoiseGraph(NoiseGraph, GraphError);
+	if (!GraphError.IsEmpty()) {
+		UE_LOG(LogProceduralTerrain, Warning, TEXT("Ignoring the noise graph, falling back to fBm. %s"), *GraphError);
+	}
+
+	BakeElevationCurve(Params.Elevation, ElevationCurve, HeightRange, ElevationLutResolution, ElevationMultiplier);
+	Params.Classifier.Build(TerrainLayersFromParams(TerrainParams), HeightRange);
+	Params.TextureFormat = TextureFormat;
+}
+
+void AEndlessTerrain::BakeParams() {
+	// Jobs already running keep the tables they started with
+	TSharedPtr<FChunkBakedParams, ESPMode::ThreadSafe> Params = MakeShared<FChunkBakedParams, ESPMode::ThreadSafe>();
+	FillBakedParams(*Params);
+
+	const uint64 ParamsHash = GenerationParamsHash();
+	if (bUseTileCache) {
+		// Only rescanned when the generation parameters actually changed
+		if (!TileCache || TileCache->GetParamsHash() != ParamsHash) {
+			const FString CacheDir = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("TerrainCache"));
+			TileCache = MakeShared<FTerrainTileCache, ESPMode::ThreadSafe>(CacheDir, ParamsHash, static_cast<int64>(TileCacheSizeMB * 1024. * 1024.));
+		}
+	}
+	else {
+		TileCache.Reset();
+	}
+	Params->TileCache = TileCache;
+
+	const FString WorldPath = BakedWorldFile.FilePath.IsEmpty() ? FString() : FPaths::ConvertRelativePathToFull(FPaths::ProjectDir(), BakedWorldFile.FilePath);
+	if (WorldPath != BakedWorldPath) {
+		BakedWorldPath = WorldPath;
+		BakedWorld.Reset();
+		if (!WorldPath.IsEmpty()) {
+			TSharedPtr<FBakedWorldReader, ESPMode::ThreadSafe> Reader = MakeShared<FBakedWorldReader, ESPMode::ThreadSafe>();
+			if (Reader->Open(WorldPath)) {
+				BakedWorld = Reader;
+			}
+			else {
+				UE_LOG(LogProceduralTerrain, Warning, TEXT("Could not open baked world %s"), *WorldPath);
+			}
+		}
+	}
+	if (BakedWorld) {
+		const FBakedWorldDesc& Desc = BakedWorld->GetDesc();
+		if (Desc.ParamsHash != ParamsHash || Desc.ChunkSamples != VerticesInChunk) {
+			UE_LOG(LogProceduralTerrain, Warning, TEXT("Baked world %s was baked with other generation parameters, ignoring it"), *BakedWorldPath);
+		}
+		else {
+			Params->BakedWorld = BakedWorld;
+			Params->bUseBakedClasses = Desc.HasClasses() && Desc.ClassifierHash == Params->Classifier.GetHash();
+			Params->bUseBakedElevations = Desc.ElevationHash == Params->Elevation.GetHash();
+		}
+	}
+
+	const EPixelFormat PixelFormat = TextureFormat == ETerrainTextureFormat::PaletteIndex ? PF_G8 : PF_B8G8R8A8;
+	if (!TexturePool.IsInitialized()) {
+		const int RetainedChunks = NumLevels() * FMath::Square(2 * (ChunksInViewDistance + EvictionHysteresis) + 1);
+		TexturePool.Init(VerticesInChunk, VerticesInChunk, PixelFormat, FMath::Max(MaxChunkTextures, RetainedChunks));
+	}
+	else if (TexturePool.GetFormat() != PixelFormat) {
+		// Resident chunks' slices are in the old format
+		UE_LOG(LogProceduralTerrain, Warning, TEXT("TextureFormat changes only apply once the terrain is recreated"));
+		Params->TextureFormat = TexturePool.GetFormat() == PF_G8 ? ETerrainTextureFormat::PaletteIndex : ETerrainTextureFormat::Color;
+	}
+	BakedParams = Params;
+
+	PaletteTexture = CreatePaletteTexture(Params->Classifier);
+	if (!MaterialInstance) {
+		MaterialInstance = UMaterialInstanceDynamic::Create(Material, this);
+		check(MaterialInstance);
+	}
+	MaterialInstance->SetTextureParameterValue("ChunkTextures", TexturePool.GetArray());
+	MaterialInstance->SetTextureParameterValue("PaletteTexture", PaletteTexture);
+	MaterialInstance->SetScalarParameterValue("PaletteIndexed", Params->TextureFormat == ETerrainTextureFormat::PaletteIndex ? 1. : 0.);
+}
+
+uint64 AEndlessTerrain::GenerationParamsHash() const {
+	// Only 4 byte members, so there's no padding to hash
+	const struct {
+		int32 RandomSeed;
+		float Scale;
+		int32 Octaves;
+		float Persistance;
+		float Lacunarity;
+		uint32 NoiseBackend;
+		int32 VerticesInChunk;
+		uint32 CacheVersion;
+	} Key = {
+		RandomSeed,
+		Scale,
+		Octaves,
+		Persistance,
+		Lacunarity,
+		static_cast<uint32>(NoiseBackend),
+		AEndlessTerrain::VerticesInChunk,
+		FTerrainTileCache::Version
+	};
+	// Same as before graphs existed when there is none, so existing caches and baked worlds stay valid
+	FString GraphError;
+	if (const TSharedPtr<const FNoiseGraph, ESPMode::ThreadSafe> Graph = BakeNoiseGraph(NoiseGraph, GraphError)) {
+		return CityHash64WithSeed(reinterpret_cast<const char*>(&Key), sizeof(Key), Graph->GetHash());
+	}
+	return CityHash64(reinterpret_cast<const char*>(&Key), sizeof(Key));
+}
+
+UProceduralMeshComponent* AEndlessTerrain::AllocateSection(FChunkKey Key, int& OutSectionIndex) {
+	FTerrainMeshShard& Shard = MeshShards.FindOrAdd(RegionOf(Key));
+	if (!Shard.Component) {
+		if (IdleShardComponents.Num() > 0) {
+			Shard.Component = IdleShardComponents.Pop(false);
+			Shard.Component->SetVisibility(true);
+		}
+		else {
+			Shard.Component = NewObject<UProceduralMeshComponent>(this, NAME_None, RF_Transient);
+			Shard.Component->SetupAttachment(RootComponent);
+			Shard.Component->RegisterComponent();
+			ShardComponents.Add(Shard.Component);
+		}
+		ActiveMeshShards = MeshShards.Num();
+	}
+
+	++Shard.NumChunks;
+	OutSectionIndex = Shard.AllocateSection();
+	Shard.Component->SetMaterial(OutSectionIndex, MaterialInstance);
+	return Shard.Component;
+}
+
+void AEndlessTerrain::FreeSection(FChunkKey Key, int SectionIndex) {
+	const FChunkKey Region = RegionOf(Key);
+	FTerrainMeshShard& Shard = MeshShards[Region];
+	Shard.FreeSections.Add(SectionIndex);
+	--Shard.NumChunks;
+	ReleaseShardIfUnused(Region);
+}
+
+void AEndlessTerrain::ReleaseShardIfUnused(FChunkKey Region) {
+	const FTerrainMeshShard* Shard = MeshShards.Find(Region);
+	if (!Shard || !Shard->IsUnused()) {
+		return;
+	}
+	// Every section was already cleared, this only drops the empty section slots and their materials
+	Shard->Component->ClearAllMeshSections();
+	Shard->Component->EmptyOverrideMaterials();
+	Shard->Component->SetVisibility(false);
+	IdleShardComponents.Add(Shard->Component);
+	MeshShards.Remove(Region);
+	ActiveMeshShards = MeshShards.Num();
+}
+
+const TArray<int32>& AEndlessTerrain::GetLodTriangles(EMapLod Lod) {
+	TArray<int32>& Triangles = LodTriangles[static_cast<int>(Lod)];
+	if (Triangles.Num() == 0) {
+		const FTerrainGrid Grid{ VerticesInChunk, VerticesInChunk, static_cast<int>(Lod), TileSize, FVector(0.) };
+		TerrainMeshing::BuildTriangles(Grid, Triangles);
+	}
+	return Triangles;
+}
+
+FTerrainChunk* AEndlessTerrain::FindChunk(FChunkKey Key) {
+	const FChunkHandle* Handle = TerrainMap.Find(Key);
+	return Handle ? ChunkPool.Get(*Handle) : nullptr;
 }
 
 void AEndlessTerrain::UpdateVisibleChunks() {
+	if (!BakedParams) {
+		BakeParams();
+	}
+
 	const FVector2D Location2D = [&]() {
 		const auto* Player = GetWorld()->GetFirstPlayerController();
 		FVector Location;
@@ -256,63 +689,386 @@ void AEndlessTerrain::UpdateVisibleChunks() {
 	}();
 	const FIntPoint OriginChunkCoord = FIntPoint(FGenericPlatformMath::RoundToInt(Location2D.X / ChunkSize()), FGenericPlatformMath::RoundToInt(Location2D.Y / ChunkSize()));
 
-	//UE_LOG(LogTemp, Display, TEXT("------------"));
-	for (const FIntPoint ChunkCoord : ChunksVisibleLastFrame) {
-		if (abs(ChunkCoord.X - OriginChunkCoord.X) > ChunksInViewDistance || 
-			abs(ChunkCoord.Y - OriginChunkCoord.Y) > ChunksInViewDistance) {
-			const FTerrainChunk& ChunkRef = TerrainMap[ChunkCoord];
-			Mesh->SetMeshSectionVisible(ChunkRef.GetSectionIndex(), false);
-			WaterMesh->SetMeshSectionVisible(ChunkRef.GetSectionIndex(), false);
-		}
-	}
-	ChunksVisibleLastFrame.Empty();
-
-	// Test Chunks around Player Location
-	TArray<FIntPoint> ChunksCreatedThisFrame;
-	for (int YOffset = -ChunksInViewDistance; YOffset <= ChunksInViewDistance; ++YOffset) {
-		for (int XOffset = -ChunksInViewDistance; XOffset <= ChunksInViewDistance; ++XOffset) {
-			const FIntPoint CurrentChunkOffset = FIntPoint(XOffset, YOffset);
-			const FIntPoint CurrentChunkCoord = OriginChunkCoord + CurrentChunkOffset;
-				
-			const int DistanceInBlocksToOrigin = CurrentChunkOffset.Size();
-			const EMapLod Lod = LodFromDistance(DistanceInBlocksToOrigin);
-
-			if (TerrainMap.Contains(CurrentChunkCoord)) {
-				//UE_LOG(LogTemp, Display, TEXT("Updating Chunk: (%d, %d)"), CurrentChunkCoord.X, CurrentChunkCoord.Y);
-
-				FTerrainChunk* ChunkPtr = TerrainMap.Find(CurrentChunkCoord);
-				if (ChunkPtr->IsReadyToUploadMesh()) {
-					ChunkPtr->UploadMesh(this);
+	if (OriginChunkCoord != RingOrigin || ChunksInViewDistance != RingRadius || NumLevels() != RingLevels) {
+		UpdateRing(OriginChunkCoord);
+	}
+	else if (UnsettledChunks.Num() > 0) {
+		TERRAIN_SCOPED_STAT(ViewRing);
+		TArray<FChunkKey> Retry = MoveTemp(UnsettledChunks);
+		for (const FChunkKey Key : Retry) {
+			if (!SettleChunk(Key, OriginChunkCoord)) {
+				UnsettledChunks.Add(Key);
+			}
+		}
+	}
+
+	Scheduler.Update(OriginChunkCoord, ChunksInViewDistance, MaxConcurrentChunkJobs);
+	QueuedChunkJobs = Scheduler.GetQueueDepth();
+	InFlightChunkJobs = Scheduler.GetInFlightCount();
+
+	UploadCompletedChunks(OriginChunkCoord);
+	UpdateFadingChunks();
+	EvictChunks(OriginChunkCoord);
+	UpdateWater();
+
+	SET_DWORD_STAT(STAT_TerrainQueuedJobs, QueuedChunkJobs);
+	SET_DWORD_STAT(STAT_TerrainInFlightJobs, InFlightChunkJobs);
+	SET_DWORD_STAT(STAT_TerrainPendingUploads, PendingChunkUploads);
+	CSV_CUSTOM_STAT(ProceduralTerrain, QueuedJobs, QueuedChunkJobs, ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(ProceduralTerrain, InFlightJobs, InFlightChunkJobs, ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(ProceduralTerrain, PendingUploads, PendingChunkUploads, ECsvCustomStatOp::Set);
+}
+
+void AEndlessTerrain::UpdateRing(FIntPoint OriginChunkCoord) {
+	TERRAIN_SCOPED_STAT(ViewRing);
+	TArray<FChunkKey> NewRing;
+	if (Layout == ETerrainLayout::Clipmap) {
+		// Every top level chunk within reach, split down from there
+		const int TopLevel = NumLevels() - 1;
+		const int Stride = 1 << TopLevel;
+		const int Reach = ChunksInViewDistance * Stride;
+		for (int Y = FloorDiv(OriginChunkCoord.Y - Reach, Stride); Y <= FloorDiv(OriginChunkCoord.Y + Reach, Stride); ++Y) {
+			for (int X = FloorDiv(OriginChunkCoord.X - Reach, Stride); X <= FloorDiv(OriginChunkCoord.X + Reach, Stride); ++X) {
+				CollectClipmapRing(FChunkKey(FIntPoint(X, Y), TopLevel), OriginChunkCoord, NewRing);
+			}
+		}
+	}
+	else {
+		for (int YOffset = -ChunksInViewDistance; YOffset <= ChunksInViewDistance; ++YOffset) {
+			for (int XOffset = -ChunksInViewDistance; XOffset <= ChunksInViewDistance; ++XOffset) {
+				NewRing.Add(OriginChunkCoord + FIntPoint(XOffset, YOffset));
+			}
+		}
+	}
+
+	const TSet<FChunkKey> NewRingSet(NewRing);
+	FadingChunks.RemoveAllSwap([&NewRingSet](FChunkKey Key) {
+		return NewRingSet.Contains(Key);
+	}, false);
+	for (const FChunkKey Key : ChunksInRing) {
+		if (!NewRingSet.Contains(Key)) {
+			if (FTerrainChunk* ChunkPtr = FindChunk(Key)) {
+				// Grid rings never overlap what left them
+				const bool bReplaced = Layout == ETerrainLayout::Clipmap && Algo::AnyOf(NewRing, [Key](FChunkKey RingKey) {
+					return RingKey.Overlaps(Key);
+				});
+				if (bReplaced && ChunkPtr->HasUploadedMesh()) {
+					FadingChunks.Add(Key);
 				}
-				if (ChunkPtr->IsReadyToUploadTexture()) {
-					ChunkPtr->UploadTexture(this);
+				else {
+					ChunkPtr->SetVisible(this, false);
 				}
-				Mesh->SetMeshSectionVisible(ChunkPtr->GetSectionIndex(), true);
-				WaterMesh->SetMeshSectionVisible(ChunkPtr->GetSectionIndex(), true);
 			}
-			else {
-				//UE_LOG(LogTemp, Display, TEXT("Creating Chunk: (%d, %d)"), CurrentChunkCoord.X, CurrentChunkCoord.Y);
+		}
+	}
+
+	RingOrigin = OriginChunkCoord;
+	RingRadius = ChunksInViewDistance;
+	RingLevels = NumLevels();
+	ChunksInRing = MoveTemp(NewRing);
+	UnsettledChunks.Reset();
+	for (const FChunkKey Key : ChunksInRing) {
+		// Lods depend on the distance to the origin, so every chunk still in the ring is looked at once
+		if (!SettleChunk(Key, OriginChunkCoord)) {
+			UnsettledChunks.Add(Key);
+		}
+	}
+}
+
+void AEndlessTerrain::CollectClipmapRing(FChunkKey Key, FIntPoint OriginChunkCoord, TArray<FChunkKey>& OutChunks) const {
+	// A child is at most half a parent further out than its parent, so splitting only parents within
+	// `ChunksInViewDistance - 1` children keeps every child within `ChunksInViewDistance` of its level
+	const int ChildStride = Key.Stride() / 2;
+	if (Key.Level == 0 || Key.OffsetFrom(OriginChunkCoord).GetMax() > (ChunksInViewDistance - 1) * ChildStride) {
+		OutChunks.Add(Key);
+		return;
+	}
+	for (int Y = 0; Y < 2; ++Y) {
+		for (int X = 0; X < 2; ++X) {
+			CollectClipmapRing(FChunkKey(Key.Coord * 2 + FIntPoint(X, Y), Key.Level - 1), OriginChunkCoord, OutChunks);
+		}
+	}
+}
+
+bool AEndlessTerrain::SettleChunk(FChunkKey Key, FIntPoint OriginChunkCoord) {
+	// In chunks of the key's own level, so every clipmap level falls off the same way
+	const int DistanceInBlocksToOrigin = Key.OffsetFrom(OriginChunkCoord).Size() / Key.Stride();
+	const EMapLod Lod = LodFromDistance(DistanceInBlocksToOrigin);
+
+	FTerrainChunk* ChunkPtr = FindChunk(Key);
+	if (!ChunkPtr) {
+		if (TexturePool.NumFree() == 0) {
+			EvictChunks(OriginChunkCoord, 1);
+		}
+		if (TexturePool.NumFree() == 0) {
+			// Every slice belongs to a chunk that has to stay
+			UE_LOG(LogProceduralTerrain, Warning, TEXT("No free chunk texture for (%d, %d) level %d, raise MaxChunkTextures"), Key.Coord.X, Key.Coord.Y, Key.Level);
+			return false;
+		}
+
+		const FChunkHandle Handle = ChunkPool.Allocate(this, Key);
+		ChunkPtr = ChunkPool.Get(Handle);
+		ChunkPtr->SetDesiredLod(Lod);
+		ChunkPtr->SetVisible(this, true);
+		TerrainMap.Add(Key, Handle);
+		Scheduler.Enqueue(Key);
+		return true;
+	}
+
+	ChunkPtr->SetVisible(this, true);
+	switch (ChunkPtr->GetState()) {
+		case EChunkState::Empty: {
+			// Its job got dropped or cancelled while it was out of range
+			ChunkPtr->SetDesiredLod(Lod);
+			Scheduler.Enqueue(Key);
+			return true;
+		}
+		case EChunkState::Queued: {
+			ChunkPtr->SetDesiredLod(Lod);
+			return true;
+		}
+		case EChunkState::Generated: {
+			if (!ChunkPtr->HasUploadedMesh() && !ChunkPtr->IsReadyToUploadMesh()) {
+				// Its first job got cancelled after the heightfield, only the mesh is missing
+				ChunkPtr->SetDesiredLod(Lod);
+				Scheduler.Enqueue(Key);
+				return true;
+			}
+			if (ChunkPtr->GetMeshLod() == Lod) {
+				return true;
+			}
+			// Remeshing only, the heightfield is kept around. Waits for the previous mesh to be uploaded first.
+			if (ChunkPtr->IsReadyToUploadMesh()) {
+				return false;
+			}
+			ChunkPtr->SetDesiredLod(Lod);
+			Scheduler.Enqueue(Key);
+			return true;
+		}
+		default: {
+			// The running job may be building another Lod, looked at again once it's done
+			return false;
+		}
+	}
+}
 
-				// TODO: For now, all work in Chunk creation is done syncronously on main thread.
-				FTerrainChunk Chunk(this, CurrentChunkCoord, ChunkSize());
-				TerrainMap.Add(CurrentChunkCoord, std::move(Chunk));
-				ChunksCreatedThisFrame.Add(CurrentChunkCoord);
+void AEndlessTerrain::UpdateFadingChunks() {
+	for (int I = FadingChunks.Num() - 1; I >= 0; --I) {
+		const FChunkKey Key = FadingChunks[I];
+		FTerrainChunk* ChunkPtr = FindChunk(Key);
+		const bool bCovered = Algo::AllOf(ChunksInRing, [this, Key](FChunkKey RingKey) {
+			if (!RingKey.Overlaps(Key)) {
+				return true;
 			}
+			const FTerrainChunk* RingChunk = FindChunk(RingKey);
+			return RingChunk && RingChunk->HasUploadedMesh();
+		});
+		if (!ChunkPtr || bCovered) {
+			if (ChunkPtr) {
+				ChunkPtr->SetVisible(this, false);
+			}
+			FadingChunks.RemoveAtSwap(I, 1, false);
+		}
+	}
+}
 
-			ChunksVisibleLastFrame.Add(CurrentChunkCoord);
+void AEndlessTerrain::UploadCompletedChunks(FIntPoint OriginChunkCoord) {
+	FChunkHandle Completed;
+	while (CompletedChunks.Dequeue(Completed)) {
+		// A remesh can complete again before the previous one was uploaded
+		PendingUploads.AddUnique(Completed);
+	}
+
+	// Evicted chunks' handles stop resolving, drop them before sorting
+	PendingUploads.RemoveAllSwap([this](FChunkHandle Handle) {
+		return ChunkPool.Get(Handle) == nullptr;
+	}, false);
+	PendingUploads.Sort([this, OriginChunkCoord](FChunkHandle A, FChunkHandle B) {
+		return ChunkPool.Get(A)->GetKey().OffsetFrom(OriginChunkCoord).SizeSquared() < ChunkPool.Get(B)->GetKey().OffsetFrom(OriginChunkCoord).SizeSquared();
+	});
+
+	const double Deadline = FPlatformTime::Seconds() + UploadBudgetMs / 1000.;
+	int Uploaded = 0;
+	while (Uploaded < PendingUploads.Num() && (Uploaded == 0 || FPlatformTime::Seconds() < Deadline)) {
+		FTerrainChunk* ChunkPtr = ChunkPool.Get(PendingUploads[Uploaded++]);
+		if (ChunkPtr->IsReadyToUploadTexture()) {
+			ChunkPtr->UploadTexture(this);
 		}
+		if (ChunkPtr->IsReadyToUploadMesh()) {
+			const bool bRemesh = ChunkPtr->HasUploadedMesh();
+			ChunkPtr->UploadMesh(this);
+			const double LatencyMs = (FPlatformTime::Seconds() - ChunkPtr->GetRequestedTime()) * 1000.;
+			(bRemesh ? RemeshLatency : ChunkVisibleLatency).AddMeasurement(LatencyMs);
+			CSV_CUSTOM_STAT(ProceduralTerrain, ChunkLatencyMs, LatencyMs, ECsvCustomStatOp::Max);
+			if (ChunkPtr->IsVisible() && !bRemesh && ChunkPtr->HasWater()) {
+				MarkWaterDirty(ChunkPtr->GetKey());
+			}
+		}
+	}
+	PendingUploads.RemoveAt(0, Uploaded, false);
+	PendingChunkUploads = PendingUploads.Num();
+}
+
+void AEndlessTerrain::EvictChunks(FIntPoint OriginChunkCoord, int MinFreeTextures) {
+	TERRAIN_SCOPED_STAT(Eviction);
+	SIZE_T ResidentBytes = 0;
+	for (const auto& Pair : TerrainMap) {
+		ResidentBytes += ChunkPool.Get(Pair.Value)->GetMemoryFootprint();
 	}
 
-	// TODO: This is probably still not completely right because the `ChunkPtr` can still get invalidated in between frames
-	for (const FIntPoint CurrentChunkCoord : ChunksCreatedThisFrame) {
-		FTerrainChunk* ChunkPtr = TerrainMap.Find(CurrentChunkCoord);
-		AsyncTask(ENamedThreads::AnyBackgroundThreadNormalTask, [ChunkPtr, this]() {
-			auto GenTask = new FAsyncTask<FAsyncChunkGenerator>(ChunkPtr, this);
-			GenTask->StartBackgroundTask();
-			GenTask->EnsureCompletion();
-			delete GenTask;
+	const SIZE_T BudgetBytes = static_cast<SIZE_T>(ChunkMemoryBudgetMB * 1024. * 1024.);
+	if (ResidentBytes > BudgetBytes || TexturePool.NumFree() < MinFreeTextures) {
+		// In chunks of each key's own level
+		const int KeepDistance = ChunksInViewDistance + EvictionHysteresis;
+		TArray<FChunkKey> Candidates;
+		for (const auto& Pair : TerrainMap) {
+			const FChunkKey Key = Pair.Key;
+			const FTerrainChunk* ChunkPtr = ChunkPool.Get(Pair.Value);
+			// A generating chunk is still referenced by its job, the scheduler cancels it once it's out of range
+			const bool bIdle = ChunkPtr->GetState() == EChunkState::Empty || ChunkPtr->GetState() == EChunkState::Generated;
+			if (bIdle && Key.OffsetFrom(OriginChunkCoord).GetMax() > KeepDistance * Key.Stride()) {
+				Candidates.Add(Key);
+			}
+		}
+		Candidates.Sort([this](const FChunkKey& A, const FChunkKey& B) {
+			return FindChunk(A)->GetLastVisibleFrame() < FindChunk(B)->GetLastVisibleFrame();
 		});
+
+		for (const FChunkKey Key : Candidates) {
+			if (ResidentBytes <= BudgetBytes && TexturePool.NumFree() >= MinFreeTextures) {
+				break;
+			}
+			const FChunkHandle Handle = TerrainMap[Key];
+			const SIZE_T ChunkBytes = ChunkPool.Get(Handle)->GetMemoryFootprint();
+			const bool bFreed = ChunkPool.TryFree(Handle, [this](FTerrainChunk& Chunk) {
+				Chunk.ReleaseResources(this);
+				FreeSection(Chunk.GetKey(), Chunk.GetSectionIndex());
+			});
+			if (bFreed) {
+				ResidentBytes -= ChunkBytes;
+				TerrainMap.Remove(Key);
+			}
+		}
 	}
+
+	ResidentChunkMemoryMB = ResidentBytes / (1024. * 1024.);
+}
+
+FChunkKey AEndlessTerrain::RegionOf(FChunkKey Key) {
+	return FChunkKey(FIntPoint(FloorDiv(Key.Coord.X, RegionChunks), FloorDiv(Key.Coord.Y, RegionChunks)), Key.Level);
+}
+
+void AEndlessTerrain::MarkWaterDirty(FChunkKey Key) {
+	DirtyWaterRegions.Add(RegionOf(Key));
+}
+
+void AEndlessTerrain::UpdateWater() {
+	if (DirtyWaterRegions.Num() == 0) {
+		return;
+	}
+	TERRAIN_SCOPED_STAT(Water);
+	for (const FChunkKey Region : DirtyWaterRegions) {
+		RebuildWaterRegion(Region);
+	}
+	DirtyWaterRegions.Reset();
+	WaterSections = 0;
+	for (const auto& Pair : MeshShards) {
+		WaterSections += Pair.Value.WaterSection != INDEX_NONE;
+	}
+}
+
+void AEndlessTerrain::RebuildWaterRegion(FChunkKey Region) {
+	auto IsWet = [this](FChunkKey Key) {
+		const FTerrainChunk* ChunkPtr = FindChunk(Key);
+		return ChunkPtr && ChunkPtr->IsVisible() && ChunkPtr->HasWater();
+	};
+
+	// Runs of wet chunks along X are merged into a single quad
+	TArray<FVector> Vertices;
+	TArray<FVector2D> Uv0;
+	TArray<int32> Triangles;
+	const FIntPoint FirstChunk = Region.Coord * RegionChunks;
+	const int Stride = Region.Stride();
+	for (int Y = FirstChunk.Y; Y < FirstChunk.Y + RegionChunks; ++Y) {
+		int RunStart = INDEX_NONE;
+		for (int X = FirstChunk.X; X <= FirstChunk.X + RegionChunks; ++X) {
+			const bool bWet = X < FirstChunk.X + RegionChunks && IsWet(FChunkKey(FIntPoint(X, Y), Region.Level));
+			if (bWet && RunStart == INDEX_NONE) {
+				RunStart = X;
+			}
+			else if (!bWet && RunStart != INDEX_NONE) {
+				const FVector2D Min = ChunkRect(FChunkKey(FIntPoint(RunStart, Y), Region.Level)).Min;
+				const FVector2D Max = ChunkRect(FChunkKey(FIntPoint(X - 1, Y), Region.Level)).Max;
+				AddWaterQuad(Min, Max, FVector2D((X - RunStart) * Stride, Stride), Vertices, Uv0, Triangles);
+				RunStart = INDEX_NONE;
+			}
+		}
+	}
+
+	// Wet chunks hold a terrain section, so the shard only goes missing once the region is dry and empty
+	FTerrainMeshShard* Shard = MeshShards.Find(Region);
+	if (!Shard) {
+		return;
+	}
+	if (Triangles.Num() == 0) {
+		if (Shard->WaterSection != INDEX_NONE) {
+			Shard->Component->ClearMeshSection(Shard->WaterSection);
+			Shard->Component->SetMaterial(Shard->WaterSection, nullptr);
+			Shard->FreeSections.Add(Shard->WaterSection);
+			Shard->WaterSection = INDEX_NONE;
+			ReleaseShardIfUnused(Region);
+		}
+		return;
+	}
+
+	if (Shard->WaterSection == INDEX_NONE) {
+		Shard->WaterSection = Shard->AllocateSection();
+		Shard->Component->SetMaterial(Shard->WaterSection, WaterMaterial);
+	}
+	Shard->Component->CreateMeshSection_LinearColor(Shard->WaterSection, Vertices, Triangles, {}, Uv0, {}, {}, false);
+}
+
+void AEndlessTerrain::DumpChunkMemory() {
+	SIZE_T TotalCpuBytes = 0;
+	SIZE_T TotalGpuBytes = 0;
+	for (const auto& Pair : TerrainMap) {
+		const FTerrainChunk* ChunkPtr = ChunkPool.Get(Pair.Value);
+		const FChunkKey Key = ChunkPtr->GetKey();
+		UE_LOG(LogProceduralTerrain, Display, TEXT("(%4d, %4d) level %d %-10s lod %2d: %8.1f KB CPU, %8.1f KB GPU"),
+			Key.Coord.X,
+			Key.Coord.Y,
+			Key.Level,
+			ChunkStateToString(ChunkPtr->GetState()),
+			static_cast<int>(ChunkPtr->GetMeshLod()),
+			ChunkPtr->GetCpuMemory() / 1024.,
+			ChunkPtr->GetGpuMemory() / 1024.
+		);
+		TotalCpuBytes += ChunkPtr->GetCpuMemory();
+		TotalGpuBytes += ChunkPtr->GetGpuMemory();
+	}
+	UE_LOG(LogProceduralTerrain, Display, TEXT("%d chunks: %.2f MB CPU, %.2f MB GPU"), TerrainMap.Num(), TotalCpuBytes / (1024. * 1024.), TotalGpuBytes / (1024. * 1024.));
+}
+
+void AEndlessTerrain::DumpLatency() {
+	UE_LOG(LogProceduralTerrain, Display, TEXT("Chunk visible latency: %d chunks, avg %.1f ms, max %.1f ms"),
+		static_cast<int>(ChunkVisibleLatency.GetNumMeasurements()), ChunkVisibleLatency.GetAverageOfAllMeasures(), ChunkVisibleLatency.GetMaxOfAllMeasures());
+	ChunkVisibleLatency.DumpToLog(TEXT("ChunkVisibleLatency (ms)"));
+	UE_LOG(LogProceduralTerrain, Display, TEXT("Remesh latency: %d chunks, avg %.1f ms, max %.1f ms"),
+		static_cast<int>(RemeshLatency.GetNumMeasurements()), RemeshLatency.GetAverageOfAllMeasures(), RemeshLatency.GetMaxOfAllMeasures());
+	RemeshLatency.DumpToLog(TEXT("RemeshLatency (ms)"));
+}
+
+bool AEndlessTerrain::ExportLatencyCsv(const FString& Path) const {
+	FString Csv = TEXT("Histogram,LowerMs,UpperMs,Count\n");
+	WriteHistogramCsv(TEXT("ChunkVisible"), ChunkVisibleLatency, Csv);
+	WriteHistogramCsv(TEXT("Remesh"), RemeshLatency, Csv);
+	return FFileHelper::SaveStringToFile(Csv, *Path);
+}
+
+void AEndlessTerrain::ResetLatency() {
+	// 25 ms buckets up to 2 s, anything slower lands in the last one
+	ChunkVisibleLatency.InitLinear(0., 2000., 25.);
+	RemeshLatency.InitLinear(0., 2000., 25.);
 }
 
 void AEndlessTerrain::BeginPlay()
@@ -320,9 +1076,25 @@ void AEndlessTerrain::BeginPlay()
 	Super::BeginPlay();
 }
 
+void AEndlessTerrain::BeginDestroy()
+{
+	// Jobs point back into `ChunkPool`
+	Scheduler.CancelAll();
+	Super::BeginDestroy();
+}
+
 void AEndlessTerrain::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
 
+	TexturePool.Tick(DeltaTime);
+	TextureAllocationsPerSecond = TexturePool.GetAllocationsPerSecond();
+	TextureUploadBytesLastFrame = TexturePool.GetUploadBytesLastFrame();
+	if (TileCache) {
+		const FTerrainTileCacheStats CacheStats = TileCache->GetStats();
+		TileCacheHits = CacheStats.Hits;
+		TileCacheMisses = CacheStats.Misses;
+	}
+
 	UpdateVisibleChunks();
 }
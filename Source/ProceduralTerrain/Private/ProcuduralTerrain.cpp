@@ -3,6 +3,9 @@
 
 #include "ProcuduralTerrain.h"
 #include "UObject/Object.h"
+#include "TerrainMeshing.h"
+#include "TerrainStats.h"
+#include "Hash/CityHash.h"
 
 AProcuduralTerrain::AProcuduralTerrain()
 	: Mesh(CreateDefaultSubobject<UProceduralMeshComponent>("GeneratedMesh"))
@@ -10,14 +13,18 @@ AProcuduralTerrain::AProcuduralTerrain()
 	, MapLod(EMapLod::One)
 	, ElevationMultiplier( (ChunkSize * TileSize) / 3.)
 	, ElevationCurve(CreateDefaultSubobject<UCurveFloat>("ElevationCurve"))
+	, ElevationLutResolution(FElevationLut::DefaultResolution)
 	, RandomSeed(1)
 	, Scale(60.)
 	, Octaves(1)
 	, Persistance(0.5)
 	, Lacunarity(1.0)
 	, NoiseOffset(FVector2D(0., 0.))
+	, NoiseBackend(ETerrainNoiseBackend::Perlin)
+	, bParallelNoise(true)
 	, DisplayTexture(EDisplayTexture::Color)
 	, TerrainParams(FTerrainParams::GetParams())
+	, PaletteTexture(nullptr)
 {
 	check(Mesh);
 	check(Material);
@@ -27,26 +34,123 @@ AProcuduralTerrain::AProcuduralTerrain()
 
 void AProcuduralTerrain::OnConstruction(const FTransform& Transform) {
 	Super::OnConstruction(Transform);
+	check((ChunkSize - 1) % static_cast<int>(MapLod) == 0);
 
-	const int Width = ChunkSize;
-	const int Height = ChunkSize;
-	check((Width - 1) % static_cast<int>(MapLod) == 0);
+	const bool bNoiseChanged = UpdateNoise();
+	const bool bClassesChanged = UpdateClassifier();
+	UpdateTexture(bNoiseChanged || bClassesChanged);
+	UpdateMaterial();
+	UpdateMesh(bNoiseChanged);
+}
 
-	Noise.Init(ENormalizeMode::Local, 0, Width, Height, Scale, Octaves, Persistance, Lacunarity, FVector2D(0, 0));
+bool AProcuduralTerrain::UpdateNoise() {
+	// Only 4 byte members, so there's no padding to hash
+	const struct {
+		float Scale;
+		int32 Octaves;
+		float Persistance;
+		float Lacunarity;
+		uint32 NoiseBackend;
+	} Key = {
+		Scale,
+		Octaves,
+		Persistance,
+		Lacunarity,
+		static_cast<uint32>(NoiseBackend)
+	};
+	FString GraphError;
+	const TSharedPtr<const FNoiseGraph, ESPMode::ThreadSafe> Graph = BakeNoiseGraph(NoiseGraph, GraphError);
+	if (!GraphError.IsEmpty()) {
+		UE_LOG(LogProceduralTerrain, Warning, TEXT("Ignoring the noise graph, falling back to fBm. %s"), *GraphError);
+	}
+	const uint64 Hash = Graph
+		? CityHash64WithSeed(reinterpret_cast<const char*>(&Key), sizeof(Key), Graph->GetHash())
+		: CityHash64(reinterpret_cast<const char*>(&Key), sizeof(Key));
+	if (Hash == NoiseInputsHash && Noise.NoiseValues.Num() > 0) {
+		return false;
+	}
+	NoiseInputsHash = Hash;
 
-	Texture = UTexture2D::CreateTransient(Width, Height, PF_B8G8R8A8, "Texture");
-	Texture->Filter = TextureFilter::TF_Nearest;
-	Texture->AddressX = TextureAddress::TA_Clamp;
-	Texture->AddressY = TextureAddress::TA_Clamp;
-	check(Texture);
-	UpdateTexture();
+	const ENoiseThreading Threading = bParallelNoise ? ENoiseThreading::Parallel : ENoiseThreading::Serial;
+	if (Graph) {
+		Noise.Init(ENormalizeMode::Local, *Graph, 0, ChunkSize, ChunkSize, Scale, FVector2D(0, 0), Threading);
+	}
+	else {
+		Noise.Init(ENormalizeMode::Local, 0, ChunkSize, ChunkSize, Scale, Octaves, Persistance, Lacunarity, FVector2D(0, 0), Threading, ToNoiseBackend(NoiseBackend));
+	}
+	return true;
+}
 
-	MaterialInstance = UMaterialInstanceDynamic::Create(Material, Mesh);
-	check(MaterialInstance);
-	MaterialInstance->SetTextureParameterValue("NoiseTexture", Texture);
-	Mesh->SetMaterial(0, MaterialInstance);
+bool AProcuduralTerrain::UpdateClassifier() {
+	// Building the tables is cheap next to rewriting the texture, so compare the result instead of the params
+	FTerrainClassifier NewClassifier;
+	NewClassifier.Build(TerrainLayersFromParams(TerrainParams), NoiseMap::NormalizedRange(ENormalizeMode::Local));
+	const uint64 Hash = NewClassifier.GetHash();
+	if (Hash == ClassifierHash && PaletteTexture) {
+		return false;
+	}
+	ClassifierHash = Hash;
+	Classifier = MoveTemp(NewClassifier);
 
-	CreateMesh();
+	if (PaletteTexture) {
+		UpdatePaletteTexture(PaletteTexture, Classifier);
+	}
+	else {
+		PaletteTexture = CreatePaletteTexture(Classifier);
+	}
+	return true;
+}
+
+bool AProcuduralTerrain::UpdateTexture(bool bForce) {
+	const bool bPaletteIndexed = DisplayTexture == EDisplayTexture::PaletteIndex;
+	const EPixelFormat Format = bPaletteIndexed ? PF_G8 : PF_B8G8R8A8;
+	if (!Texture || Texture->GetPixelFormat() != Format) {
+		Texture = UTexture2D::CreateTransient(ChunkSize, ChunkSize, Format, NAME_None);
+		check(Texture);
+		Texture->Filter = TextureFilter::TF_Nearest;
+		Texture->AddressX = TextureAddress::TA_Clamp;
+		Texture->AddressY = TextureAddress::TA_Clamp;
+		// Indices have to reach the material unchanged
+		Texture->SRGB = !bPaletteIndexed;
+	}
+	else if (!bForce && DisplayTexture == TextureDisplay) {
+		return false;
+	}
+	TextureDisplay = DisplayTexture;
+
+	FTexture2DMipMap* MipMap = &Texture->GetPlatformData()->Mips[0];
+	FByteBulkData* ImageData = &MipMap->BulkData;
+	uint8* RawImageData = (uint8*)ImageData->Lock(LOCK_READ_WRITE);
+	switch (DisplayTexture)
+	{
+		case EDisplayTexture::Noise: {
+			TerrainTexturing::WriteGrayscale(Noise.NoiseValues, RawImageData);
+			break;
+		}
+		case EDisplayTexture::Color: {
+			TerrainTexturing::WriteColors(Noise.NoiseValues, Classifier, RawImageData);
+			break;
+		}
+		case EDisplayTexture::PaletteIndex: {
+			TerrainTexturing::WriteIndices(Noise.NoiseValues, Classifier, RawImageData);
+			break;
+		}
+	}
+	ImageData->Unlock();
+	Texture->UpdateResource();
+	return true;
+}
+
+void AProcuduralTerrain::UpdateMaterial() {
+	if (!MaterialInstance || MaterialInstance->Parent != Material) {
+		MaterialInstance = UMaterialInstanceDynamic::Create(Material, Mesh);
+		check(MaterialInstance);
+		Mesh->SetMaterial(0, MaterialInstance);
+	}
+	// Parameter updates are cheap, the textures themselves are only replaced when their format changes
+	MaterialInstance->SetTextureParameterValue("NoiseTexture", Texture);
+	MaterialInstance->SetTextureParameterValue("PaletteTexture", PaletteTexture);
+	MaterialInstance->SetScalarParameterValue("PaletteIndexed", DisplayTexture == EDisplayTexture::PaletteIndex ? 1. : 0.);
 }
 
 void AProcuduralTerrain::BeginPlay()
@@ -59,118 +163,58 @@ void AProcuduralTerrain::Tick(float DeltaTime)
 	Super::Tick(DeltaTime);
 }
 
-void AProcuduralTerrain::CreateMesh() {
-	const int StepSize = static_cast<int>(MapLod);
+void AProcuduralTerrain::UpdateMesh(bool bForce) {
 	const int Width = AProcuduralTerrain::ChunkSize;
 	const int Height = AProcuduralTerrain::ChunkSize;
 
-	const int VerticesPerRow = (Width - 1) / StepSize + 1;
-	const int NumIndices = (VerticesPerRow - 1) * (VerticesPerRow - 1) * 6;
-
 	const float TotalWidth = Width * TileSize;
 	const float TotalHeight = Height * TileSize;
 
-	const float XOffset = -TotalWidth / 2.;
-	const float YOffset = -TotalHeight / 2.;
-	const float ZOffset = 10.0;
+	const FTerrainGrid Grid{
+		Width,
+		Height,
+		static_cast<int>(MapLod),
+		TileSize,
+		FVector(-TotalWidth / 2., -TotalHeight / 2., 10.0)
+	};
+
+	BakeElevationCurve(ElevationLut, ElevationCurve, NoiseMap::NormalizedRange(ENormalizeMode::Local), ElevationLutResolution, ElevationMultiplier);
+	const uint64 Hash = ElevationLut.GetHash();
+	const bool bTopologyChanged = Triangles.Num() == 0 || MapLod != MeshLod || Mesh->GetNumSections() == 0;
+	if (!bForce && !bTopologyChanged && Hash == ElevationHash) {
+		return;
+	}
+	ElevationHash = Hash;
 
 	TArray<FVector> Vertices;
 	TArray<FVector2D> Uv0;
-	TArray<int32> Triangles;
-	for (int Y = 0; Y < Height; Y += StepSize) {
-		const int YSteps = Y / StepSize;
-		const int YIndexOffset = YSteps * VerticesPerRow;
-		for (int X = 0; X < Width; X += StepSize) {
-			const int XSteps = X / StepSize;
-
-			// TODO: Duplicated code here, think about it soon, maybe save normalized noise instead of absolute
-			const int NoiseIndex = Y * Width + X;
-			const float NoiseValue = Noise.NoiseValues[NoiseIndex];
-
-			const float XPos = X * TileSize;
-			const float YPos = Y * TileSize;
-			float MultiplierEffectiveness = 1.0;
-			if (IsValid(ElevationCurve)) {
-				MultiplierEffectiveness = ElevationCurve->GetFloatValue(NoiseValue);
-			}
-			Vertices.Add(FVector(XPos + XOffset, YPos + YOffset, ZOffset + MultiplierEffectiveness * ElevationMultiplier));
-
-			const float U = (float)X / Width;
-			const float V = (float)Y / Width;
-			Uv0.Add(FVector2D(U, V));
-
-			if (Y < (Height - 1) && X < (Width - 1)) {				
-				const int CurrentIndex = YIndexOffset + XSteps;
-				// Vertex setup
-				//   0      1      2      3    ..    W-1
-				// (0+W)  (1+W)  (2+W)  (3+W)  .. (2W - 1)
-				// ...
-				
-				// Both triangles need to have counter-clockwise winding-order
-				//     X
-				//     |\
-				//     | \
-				// X+W --- x+W+1
-				Triangles.Add(CurrentIndex);
-				Triangles.Add(CurrentIndex + VerticesPerRow);
-				Triangles.Add(CurrentIndex + VerticesPerRow + 1);
-
-				// X --- X+1    
-				//   \ |
-				//    \|
-				//     X+W+1
-				Triangles.Add(CurrentIndex);
-				Triangles.Add(CurrentIndex + VerticesPerRow + 1);
-				Triangles.Add(CurrentIndex + 1);
-			}
-		}
-	}
-	check(Triangles.Num() == NumIndices);
+	TerrainMeshing::BuildVertices(Grid, Noise.NoiseValues, ElevationLut, Vertices, Uv0);
 
-	Mesh->CreateMeshSection_LinearColor(0, Vertices, Triangles, {}, Uv0, {}, {}, false);
+	if (bTopologyChanged) {
+		MeshLod = MapLod;
+		TerrainMeshing::BuildTriangles(Grid, Triangles);
+		Mesh->CreateMeshSection_LinearColor(0, Vertices, Triangles, {}, Uv0, {}, {}, false);
+	}
+	else {
+		// Same vertex count and indices, only the positions moved
+		Mesh->UpdateMeshSection_LinearColor(0, Vertices, {}, Uv0, {}, {});
+	}
 }
 
-void AProcuduralTerrain::UpdateTexture() {
-	const int Width = AProcuduralTerrain::ChunkSize;
-	const int Height = AProcuduralTerrain::ChunkSize;
+UTexture2D* CreatePaletteTexture(const FTerrainClassifier& Classifier) {
+	UTexture2D* PaletteTexture = UTexture2D::CreateTransient(TerrainTexturing::PaletteTextureWidth, 1, PF_B8G8R8A8);
+	check(PaletteTexture);
+	PaletteTexture->Filter = TextureFilter::TF_Nearest;
+	PaletteTexture->AddressX = TextureAddress::TA_Clamp;
+	PaletteTexture->AddressY = TextureAddress::TA_Clamp;
 
-	FTexture2DMipMap* MipMap = &Texture->GetPlatformData()->Mips[0];
-	FByteBulkData* ImageData = &MipMap->BulkData;
-	uint8* RawImageData = (uint8*)ImageData->Lock(LOCK_READ_WRITE);
-	const int PixelSize = 4;
-	for (int Y = 0; Y < Height; ++Y) {
-		for (int X = 0; X < Width; ++X) {
-			const int NoiseIndex = Y * Width + X;
-			const float NoiseValue = Noise.NoiseValues[NoiseIndex];
-
-			const int TextureIndex = NoiseIndex * PixelSize;
-			switch (DisplayTexture)
-			{
-				case EDisplayTexture::Noise: {
-					const uint8 NoiseTexColor = NoiseValue * 255.;
-					RawImageData[TextureIndex] = NoiseTexColor;
-					RawImageData[TextureIndex + 1] = NoiseTexColor;
-					RawImageData[TextureIndex + 2] = NoiseTexColor;
-					RawImageData[TextureIndex + 3] = 255;
-					break;
-				}
-				case EDisplayTexture::Color: {
-					for (const FTerrainParams& Param : TerrainParams) {
-						if (NoiseValue <= Param.MaxHeight) {
-							const FColor Color = Param.Color;
-
-							RawImageData[TextureIndex] = Color.B;
-							RawImageData[TextureIndex + 1] = Color.G;
-							RawImageData[TextureIndex + 2] = Color.R;
-							RawImageData[TextureIndex + 3] = 255;
-							break;
-						}
-					}
-					break;
-				}
-			}
-		}
-	}
+	UpdatePaletteTexture(PaletteTexture, Classifier);
+	return PaletteTexture;
+}
+
+void UpdatePaletteTexture(UTexture2D* PaletteTexture, const FTerrainClassifier& Classifier) {
+	FByteBulkData* ImageData = &PaletteTexture->GetPlatformData()->Mips[0].BulkData;
+	TerrainTexturing::WritePalette(Classifier, (uint8*)ImageData->Lock(LOCK_READ_WRITE));
 	ImageData->Unlock();
-	Texture->UpdateResource();
-}
\ No newline at end of file
+	PaletteTexture->UpdateResource();
+}
@@ -0,0 +1,133 @@
+#include "TerrainBakeCommandlet.h"
+#include "EndlessTerrain.h"
+#include "TerrainBakedWorld.h"
+#include "TerrainStats.h"
+#include "Async/ParallelFor.h"
+#include "HAL/FileManager.h"
+#include "Misc/Paths.h"
+
+namespace {
+	const AEndlessTerrain* FindTerrain(const FString& Path) {
+		if (Path.IsEmpty()) {
+			return GetDefault<AEndlessTerrain>();
+		}
+		if (const UClass* Class = LoadObject<UClass>(nullptr, *Path)) {
+			return Class->IsChildOf<AEndlessTerrain>() ? Class->GetDefaultObject<AEndlessTerrain>() : nullptr;
+		}
+		return LoadObject<AEndlessTerrain>(nullptr, *Path);
+	}
+}
+
+UTerrainBakeCommandlet::UTerrainBakeCommandlet() {
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UTerrainBakeCommandlet::Main(const FString& Params) {
+	FString TerrainPath;
+	FParse::Value(*Params, TEXT("Terrain="), TerrainPath);
+	const AEndlessTerrain* Terrain = FindTerrain(TerrainPath);
+	if (!Terrain) {
+		UE_LOG(LogProceduralTerrain, Error, TEXT("No AEndlessTerrain at '%s'"), *TerrainPath);
+		return 1;
+	}
+
+	FIntRect Bounds;
+	if (!FParse::Value(*Params, TEXT("MinX="), Bounds.Min.X) || !FParse::Value(*Params, TEXT("MinY="), Bounds.Min.Y)
+		|| !FParse::Value(*Params, TEXT("MaxX="), Bounds.Max.X) || !FParse::Value(*Params, TEXT("MaxY="), Bounds.Max.Y)) {
+		UE_LOG(LogProceduralTerrain, Error, TEXT("Usage: -run=TerrainBake -MinX= -MinY= -MaxX= -MaxY= [-Terrain=] [-Out=] [-Lods=1,2,4] [-NoClasses] [-Batch=]"));
+		return 1;
+	}
+	// Inclusive on the command line, exclusive in the file
+	Bounds.Max += FIntPoint(1, 1);
+	if (Bounds.Area() <= 0) {
+		UE_LOG(LogProceduralTerrain, Error, TEXT("Empty chunk range"));
+		return 1;
+	}
+
+	FString OutPath = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("BakedWorld.tbw"));
+	FParse::Value(*Params, TEXT("Out="), OutPath);
+	OutPath = FPaths::ConvertRelativePathToFull(FPaths::ProjectDir(), OutPath);
+
+	FString LodsArg = TEXT("1,2,4,6,8,10,12");
+	FParse::Value(*Params, TEXT("Lods="), LodsArg, false);
+	TArray<FString> LodTokens;
+	LodsArg.ParseIntoArray(LodTokens, TEXT(","));
+	TArray<int> LodSteps;
+	for (const FString& Token : LodTokens) {
+		const int Step = FCString::Atoi(*Token);
+		if (Step <= 0 || (AEndlessTerrain::VerticesInChunk - 1) % Step != 0) {
+			UE_LOG(LogProceduralTerrain, Error, TEXT("Lod step %s doesn't divide a chunk"), *Token);
+			return 1;
+		}
+		LodSteps.AddUnique(Step);
+	}
+
+	int BatchSize = 256;
+	FParse::Value(*Params, TEXT("Batch="), BatchSize);
+	BatchSize = FMath::Max(BatchSize, 1);
+
+	// Chunks are spread over the workers, so each one generates its noise serially
+	FChunkBakedParams BakedParams;
+	Terrain->FillBakedParams(BakedParams);
+	BakedParams.NoiseThreading = ENoiseThreading::Serial;
+
+	FBakedWorldDesc Desc;
+	Desc.ParamsHash = Terrain->GenerationParamsHash();
+	const bool bWriteClasses = !FParse::Param(*Params, TEXT("NoClasses"));
+	Desc.ClassifierHash = bWriteClasses ? BakedParams.Classifier.GetHash() : 0;
+	Desc.ElevationHash = LodSteps.Num() > 0 ? BakedParams.Elevation.GetHash() : 0;
+	Desc.ChunkRect = Bounds;
+	Desc.ChunkSamples = AEndlessTerrain::VerticesInChunk;
+	Desc.LodSteps = LodSteps;
+
+	IFileManager::Get().MakeDirectory(*FPaths::GetPath(OutPath), true);
+	FBakedWorldWriter Writer(OutPath, Desc);
+	if (!Writer.IsValid()) {
+		UE_LOG(LogProceduralTerrain, Error, TEXT("Could not open %s for writing"), *OutPath);
+		return 1;
+	}
+
+	UE_LOG(LogProceduralTerrain, Display, TEXT("Baking %d chunks (%d, %d) to (%d, %d) into %s"),
+		Desc.NumChunks(), Bounds.Min.X, Bounds.Min.Y, Bounds.Max.X - 1, Bounds.Max.Y - 1, *OutPath);
+
+	// Generated in parallel a batch at a time, written in order so the file only ever holds one batch in memory
+	const int NumChunks = Desc.NumChunks();
+	const int Width = Bounds.Width();
+	const double StartTime = FPlatformTime::Seconds();
+	TArray<FBakedChunk> Batch;
+	for (int BatchStart = 0; BatchStart < NumChunks; BatchStart += BatchSize) {
+		const int BatchCount = FMath::Min(BatchSize, NumChunks - BatchStart);
+		Batch.SetNum(BatchCount);
+
+		ParallelFor(BatchCount, [&](int Index) {
+			const int ChunkIndex = BatchStart + Index;
+			const FIntPoint ChunkCoord = Bounds.Min + FIntPoint(ChunkIndex % Width, ChunkIndex / Width);
+			FTerrainChunk::Bake(BakedParams, ChunkCoord, LodSteps, bWriteClasses, Batch[Index]);
+		});
+
+		for (int Index = 0; Index < BatchCount; ++Index) {
+			const int ChunkIndex = BatchStart + Index;
+			const FIntPoint ChunkCoord = Bounds.Min + FIntPoint(ChunkIndex % Width, ChunkIndex / Width);
+			if (!Writer.Add(ChunkCoord, Batch[Index])) {
+				UE_LOG(LogProceduralTerrain, Error, TEXT("Failed writing chunk (%d, %d)"), ChunkCoord.X, ChunkCoord.Y);
+				return 1;
+			}
+		}
+
+		const double Elapsed = FPlatformTime::Seconds() - StartTime;
+		UE_LOG(LogProceduralTerrain, Display, TEXT("%d / %d chunks, %.1f chunks/s"), BatchStart + BatchCount, NumChunks, (BatchStart + BatchCount) / Elapsed);
+	}
+
+	if (!Writer.Finish()) {
+		UE_LOG(LogProceduralTerrain, Error, TEXT("Failed finishing %s"), *OutPath);
+		return 1;
+	}
+
+	const double Elapsed = FPlatformTime::Seconds() - StartTime;
+	UE_LOG(LogProceduralTerrain, Display, TEXT("Baked %d chunks in %.2fs (%.1f chunks/s), %.1f MB"),
+		NumChunks, Elapsed, NumChunks / Elapsed, IFileManager::Get().FileSize(*OutPath) / (1024. * 1024.));
+	return 0;
+}
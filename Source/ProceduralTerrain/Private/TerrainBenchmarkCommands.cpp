@@ -0,0 +1,42 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "TerrainBenchmark.h"
+#include "HAL/IConsoleManager.h"
+
+namespace {
+	// Usage: Terrain.BenchmarkNoiseKernels [Width] [Octaves] [Iterations]
+	FAutoConsoleCommand BenchmarkNoiseKernelsCommand(
+		TEXT("Terrain.BenchmarkNoiseKernels"),
+		TEXT("Measures throughput of each Perlin noise kernel against the FMath reference. Args: [Width] [Octaves] [Iterations]"),
+		FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args) {
+			const int Width = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 241;
+			const int Octaves = Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 8;
+			const int Iterations = Args.Num() > 2 ? FCString::Atoi(*Args[2]) : 4;
+			TerrainBenchmark::RunNoiseKernels(Width, Octaves, Iterations);
+		})
+	);
+
+	// Usage: Terrain.BenchmarkNoiseBackends [Width] [Iterations]
+	FAutoConsoleCommand BenchmarkNoiseBackendsCommand(
+		TEXT("Terrain.BenchmarkNoiseBackends"),
+		TEXT("Compares the noise backends' octave-unrolled kernels against one pass per octave, with value range and smoothness stats. Args: [Width] [Iterations]"),
+		FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args) {
+			const int Width = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 241;
+			const int Iterations = Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 4;
+			TerrainBenchmark::RunNoiseBackends(Width, Iterations);
+		})
+	);
+
+	// Usage: Terrain.Benchmark [Iterations]
+	FAutoConsoleCommand BenchmarkCommand(
+		TEXT("Terrain.Benchmark"),
+		TEXT("Runs the noise, meshing and texturing benchmark suite. Args: [Iterations]"),
+		FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args) {
+			FTerrainBenchmarkConfig Config;
+			if (Args.Num() > 0) {
+				Config.Iterations = FCString::Atoi(*Args[0]);
+			}
+			TerrainBenchmark::LogResults(TerrainBenchmark::RunSuite(Config));
+		})
+	);
+}
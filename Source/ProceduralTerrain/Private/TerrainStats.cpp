@@ -0,0 +1,20 @@
+#include "TerrainStats.h"
+
+DEFINE_LOG_CATEGORY(LogProceduralTerrain);
+
+DEFINE_STAT(STAT_TerrainNoise);
+DEFINE_STAT(STAT_TerrainFusedGeneration);
+DEFINE_STAT(STAT_TerrainClassification);
+DEFINE_STAT(STAT_TerrainMeshing);
+DEFINE_STAT(STAT_TerrainNormals);
+DEFINE_STAT(STAT_TerrainTextureUpload);
+DEFINE_STAT(STAT_TerrainMeshUpload);
+DEFINE_STAT(STAT_TerrainViewRing);
+DEFINE_STAT(STAT_TerrainEviction);
+DEFINE_STAT(STAT_TerrainWater);
+
+DEFINE_STAT(STAT_TerrainQueuedJobs);
+DEFINE_STAT(STAT_TerrainInFlightJobs);
+DEFINE_STAT(STAT_TerrainPendingUploads);
+
+CSV_DEFINE_CATEGORY_MODULE(PROCEDURALTERRAIN_API, ProceduralTerrain, true);
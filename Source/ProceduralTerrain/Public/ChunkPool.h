@@ -0,0 +1,134 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include <atomic>
+
+// Refers to a pool slot, and only resolves while the slot still holds the element it was handed out for
+struct FChunkHandle {
+	uint32 Index = MAX_uint32;
+	uint32 Generation = 0;
+
+	bool IsSet() const {
+		return Index != MAX_uint32;
+	}
+
+	bool operator==(const FChunkHandle& Other) const {
+		return Index == Other.Index && Generation == Other.Generation;
+	}
+};
+
+// Slab allocator with stable element addresses. Slots are recycled through a free list and carry a generation
+// that is bumped on every free, so stale handles fail to resolve instead of aliasing the slot's next occupant.
+// Allocate/Free/Get are game thread only, Pin/Unpin can be called from any thread.
+template<typename ElementType, uint32 ElementsPerSlab = 64, uint32 MaxSlabs = 1024>
+class TChunkPool {
+public:
+	TChunkPool() = default;
+	TChunkPool(const TChunkPool&) = delete;
+	TChunkPool& operator=(const TChunkPool&) = delete;
+
+	~TChunkPool() {
+		for (uint32 SlabIndex = 0; SlabIndex < NumSlabs; ++SlabIndex) {
+			for (FSlot& Slot : Slabs[SlabIndex]->Slots) {
+				if (Slot.bAlive) {
+					Slot.Storage.GetTypedPtr()->~ElementType();
+				}
+			}
+			delete Slabs[SlabIndex];
+		}
+	}
+
+	template<typename... ArgTypes>
+	FChunkHandle Allocate(ArgTypes&&... Args) {
+		if (FreeSlots.Num() == 0) {
+			checkf(NumSlabs < MaxSlabs, TEXT("Chunk pool is full"));
+			Slabs[NumSlabs] = new FSlab();
+			for (uint32 I = ElementsPerSlab; I > 0; --I) {
+				FreeSlots.Add(NumSlabs * ElementsPerSlab + I - 1);
+			}
+			++NumSlabs;
+		}
+
+		const uint32 Index = FreeSlots.Pop(false);
+		FSlot& Slot = GetSlot(Index);
+		new (Slot.Storage.GetTypedPtr()) ElementType(Forward<ArgTypes>(Args)...);
+		Slot.bAlive = true;
+		++NumAlive;
+		return FChunkHandle{ Index, static_cast<uint32>(Slot.State.load() >> 32) };
+	}
+
+	// Invalidates the handle and destroys the element, `BeforeDestroy` runs after the handle stopped resolving.
+	// Fails if a worker has the slot pinned.
+	bool TryFree(FChunkHandle Handle, TFunctionRef<void(ElementType&)> BeforeDestroy) {
+		if (!Handle.IsSet() || Handle.Index >= NumSlabs * ElementsPerSlab) {
+			return false;
+		}
+		FSlot& Slot = GetSlot(Handle.Index);
+		uint64 Expected = static_cast<uint64>(Handle.Generation) << 32;
+		const uint64 Next = static_cast<uint64>(Handle.Generation + 1) << 32;
+		if (!Slot.bAlive || !Slot.State.compare_exchange_strong(Expected, Next)) {
+			return false;
+		}
+
+		BeforeDestroy(*Slot.Storage.GetTypedPtr());
+		Slot.Storage.GetTypedPtr()->~ElementType();
+		Slot.bAlive = false;
+		--NumAlive;
+		FreeSlots.Add(Handle.Index);
+		return true;
+	}
+
+	ElementType* Get(FChunkHandle Handle) {
+		if (!Handle.IsSet() || Handle.Index >= NumSlabs * ElementsPerSlab) {
+			return nullptr;
+		}
+		FSlot& Slot = GetSlot(Handle.Index);
+		if (!Slot.bAlive || (Slot.State.load() >> 32) != Handle.Generation) {
+			return nullptr;
+		}
+		return Slot.Storage.GetTypedPtr();
+	}
+
+	// Keeps the slot from being freed until `Unpin`, returns null if the handle is stale
+	ElementType* Pin(FChunkHandle Handle) {
+		FSlot& Slot = GetSlot(Handle.Index);
+		uint64 State = Slot.State.load();
+		do {
+			if ((State >> 32) != Handle.Generation) {
+				return nullptr;
+			}
+		} while (!Slot.State.compare_exchange_weak(State, State + 1));
+		return Slot.Storage.GetTypedPtr();
+	}
+
+	void Unpin(FChunkHandle Handle) {
+		GetSlot(Handle.Index).State.fetch_sub(1);
+	}
+
+	int Num() const {
+		return NumAlive;
+	}
+
+private:
+	struct FSlot {
+		TTypeCompatibleBytes<ElementType> Storage;
+		// Generation in the high 32 bits, pin count in the low 32 bits. Starts at generation 1 so
+		// default constructed handles never resolve.
+		std::atomic<uint64> State{ 1ull << 32 };
+		bool bAlive = false;
+	};
+
+	struct FSlab {
+		FSlot Slots[ElementsPerSlab];
+	};
+
+	FSlot& GetSlot(uint32 Index) {
+		return Slabs[Index / ElementsPerSlab]->Slots[Index % ElementsPerSlab];
+	}
+
+	// Fixed directory so workers never read a container the game thread is growing
+	FSlab* Slabs[MaxSlabs] = {};
+	uint32 NumSlabs = 0;
+	TArray<uint32> FreeSlots;
+	int NumAlive = 0;
+};
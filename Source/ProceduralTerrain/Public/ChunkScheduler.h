@@ -0,0 +1,166 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/AsyncWork.h"
+#include "ChunkPool.h"
+#include "ElevationLut.h"
+#include "TerrainTexturing.h"
+#include "TerrainTileCache.h"
+#include "TerrainBakedWorld.h"
+#include <ProcuduralTerrain.h>
+
+class AEndlessTerrain;
+struct FTerrainChunk;
+
+// A chunk on one level of the terrain. Level L chunks are 2^L level 0 chunks wide and cover the level 0 chunks
+// from `Coord * 2^L` to `Coord * 2^L + 2^L - 1`, sampling the noise every 2^L samples, so a level holds
+// `AEndlessTerrain::VerticesInChunk` squared samples per chunk at any level. Only clipmap terrains go past level 0.
+struct FChunkKey {
+	FIntPoint Coord = FIntPoint(0, 0);
+	int32 Level = 0;
+
+	FChunkKey() = default;
+	FChunkKey(FIntPoint InCoord, int32 InLevel = 0)
+		: Coord(InCoord)
+		, Level(InLevel)
+	{}
+
+	int Stride() const {
+		return 1 << Level;
+	}
+
+	// Per axis distance in level 0 chunks from `ChunkCoord` to the nearest level 0 chunk this one covers, zero
+	// on axes it spans. The plain offset at level 0.
+	FIntPoint OffsetFrom(FIntPoint ChunkCoord) const {
+		auto Axis = [Stride = Stride()](int First, int C) {
+			return C < First ? First - C : FMath::Max(C - (First + Stride - 1), 0);
+		};
+		return FIntPoint(Axis(Coord.X * Stride(), ChunkCoord.X), Axis(Coord.Y * Stride(), ChunkCoord.Y));
+	}
+
+	// Whether both cover some of the same level 0 chunks
+	bool Overlaps(const FChunkKey& Other) const {
+		const FIntPoint Min = Coord * Stride();
+		const FIntPoint OtherMin = Other.Coord * Other.Stride();
+		return Min.X < OtherMin.X + Other.Stride() && OtherMin.X < Min.X + Stride()
+			&& Min.Y < OtherMin.Y + Other.Stride() && OtherMin.Y < Min.Y + Stride();
+	}
+
+	bool operator==(const FChunkKey& Other) const {
+		return Coord == Other.Coord && Level == Other.Level;
+	}
+
+	bool operator!=(const FChunkKey& Other) const {
+		return !(*this == Other);
+	}
+
+	friend uint32 GetTypeHash(const FChunkKey& Key) {
+		return HashCombine(GetTypeHash(Key.Coord), GetTypeHash(Key.Level));
+	}
+};
+
+// Everything chunk jobs read from the terrain's parameters that is expensive to evaluate or lives in UObjects,
+// baked on the game thread. Replaced, never modified, when the parameters change.
+struct FChunkBakedParams {
+	int RandomSeed = 0;
+	float Scale = 1.;
+	int Octaves = 1;
+	float Persistance = 0.5;
+	float Lacunarity = 1.;
+	ENoiseThreading NoiseThreading = ENoiseThreading::Serial;
+	ENoiseBackend NoiseBackend = ENoiseBackend::Perlin;
+	// Replaces the fBm parameters above when set
+	TSharedPtr<const FNoiseGraph, ESPMode::ThreadSafe> NoiseGraph;
+
+	// Null if disabled
+	TSharedPtr<FTerrainTileCache, ESPMode::ThreadSafe> TileCache;
+	// Pre-generated chunks, null if none were baked with these parameters. Baked classes and elevations are
+	// only used if they were baked with the same layers and elevation curve.
+	TSharedPtr<const FBakedWorldReader, ESPMode::ThreadSafe> BakedWorld;
+	bool bUseBakedClasses = false;
+	bool bUseBakedElevations = false;
+
+	FElevationLut Elevation;
+	FTerrainClassifier Classifier;
+	ETerrainTextureFormat TextureFormat = ETerrainTextureFormat::Color;
+};
+
+struct FAsyncChunkGenerator : public FNonAbandonableTask {
+public:
+	FAsyncChunkGenerator(FChunkHandle Chunk, AEndlessTerrain* ParentTerrain, TSharedPtr<const FChunkBakedParams, ESPMode::ThreadSafe> BakedParams) :
+		Chunk(Chunk),
+		ParentTerrain(ParentTerrain),
+		BakedParams(MoveTemp(BakedParams))
+	{}
+
+	FORCEINLINE TStatId GetStatId() const {
+		RETURN_QUICK_DECLARE_CYCLE_STAT(FAsyncChunkGenerator, STATGROUP_ThreadPoolAsyncTasks);
+	}
+
+	void DoWork();
+
+	// Checked between generation stages, set from the game thread
+	FThreadSafeBool bCancelled = false;
+	// False if the job bailed out before the chunk got all its resources, or its slot was recycled
+	bool bCompleted = false;
+private:
+	FChunkHandle Chunk;
+	AEndlessTerrain* ParentTerrain;
+	// Snapshot taken when the job started, stays valid if the terrain rebakes its parameters meanwhile
+	TSharedPtr<const FChunkBakedParams, ESPMode::ThreadSafe> BakedParams;
+};
+
+// Generates chunks on the thread pool, nearest to the player first, with a bounded number of jobs in flight.
+// Only ever touched from the game thread.
+class FChunkGenerationScheduler {
+public:
+	explicit FChunkGenerationScheduler(AEndlessTerrain* Terrain = nullptr);
+	~FChunkGenerationScheduler();
+
+	void Enqueue(FChunkKey Key);
+
+	// Reprioritizes the queue if the origin moved, drops queued jobs and cancels in flight ones that are further
+	// than `Range` chunks of their own level away, reaps finished jobs and starts new ones up to `MaxConcurrentJobs`.
+	void Update(FIntPoint NewOriginChunkCoord, int Range, int MaxConcurrentJobs);
+
+	// Blocks until every in flight job finished or bailed out
+	void CancelAll();
+
+	int GetQueueDepth() const {
+		return Queue.Num();
+	}
+
+	int GetInFlightCount() const {
+		return InFlight.Num();
+	}
+
+private:
+	struct FQueuedJob {
+		FChunkKey Key;
+		int Priority;
+	};
+
+	struct FInFlightJob {
+		FChunkKey Key;
+		FChunkHandle Chunk;
+		FAsyncTask<FAsyncChunkGenerator>* Task;
+	};
+
+	struct FQueuedJobPredicate {
+		bool operator()(const FQueuedJob& A, const FQueuedJob& B) const {
+			return A.Priority < B.Priority;
+		}
+	};
+
+	int PriorityOf(FChunkKey Key) const;
+	bool IsInRange(FChunkKey Key, int Range) const;
+	void ReapFinishedJobs();
+	void FinishJob(const FInFlightJob& Job);
+
+	AEndlessTerrain* Terrain;
+	FIntPoint OriginChunkCoord;
+
+	// Min-heap on `Priority`
+	TArray<FQueuedJob> Queue;
+	TArray<FInFlightJob> InFlight;
+};
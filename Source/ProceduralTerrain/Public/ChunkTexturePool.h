@@ -0,0 +1,64 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/Texture2DArray.h"
+#include "ChunkTexturePool.generated.h"
+
+// One texture array holding every chunk's texture, chunks own a slice each and sample it through the slice
+// index in their UV1. `Array` is only referenced from here, so the pool has to be a UPROPERTY of its owner.
+// Game thread only.
+USTRUCT()
+struct FChunkTexturePool {
+	GENERATED_BODY()
+
+	// Creates the array, every slice starts out free
+	void Init(int InWidth, int InHeight, EPixelFormat InFormat, int NumSlices);
+
+	bool IsInitialized() const {
+		return Array != nullptr;
+	}
+
+	// INDEX_NONE if every slice is taken
+	int AcquireSlice();
+	void ReleaseSlice(int Slice);
+
+	// Hands `Data` over to the render thread, which writes it into `Slice` and frees it
+	void Upload(int Slice, TArray<uint8>&& Data);
+
+	// Rolls the per frame and per second counters
+	void Tick(float DeltaTime);
+
+	UTexture2DArray* GetArray() const {
+		return Array;
+	}
+
+	EPixelFormat GetFormat() const {
+		return Format;
+	}
+
+	int NumFree() const {
+		return FreeSlices.Num();
+	}
+
+	float GetAllocationsPerSecond() const {
+		return AllocationsPerSecond;
+	}
+
+	int64 GetUploadBytesLastFrame() const {
+		return UploadBytesLastFrame;
+	}
+
+private:
+	UPROPERTY(Transient)
+	UTexture2DArray* Array = nullptr;
+	TArray<int> FreeSlices;
+	int Width = 0;
+	int Height = 0;
+	EPixelFormat Format = PF_Unknown;
+
+	int AllocationsInWindow = 0;
+	float AllocationWindowSeconds = 0.;
+	float AllocationsPerSecond = 0.;
+	int64 UploadBytesThisFrame = 0;
+	int64 UploadBytesLastFrame = 0;
+};
@@ -1,16 +1,69 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Containers/StaticArray.h"
+#include "Containers/Queue.h"
+#include "ProfilingDebugging/Histogram.h"
 #include <ProcuduralTerrain.h>
+#include "QuantizedHeightfield.h"
+#include "ChunkPool.h"
+#include "ChunkScheduler.h"
+#include "ChunkTexturePool.h"
+#include "TerrainPipeline.h"
 #include "EndlessTerrain.generated.h"
 
+// Generation state, only read and written on the game thread
+enum class EChunkState : uint8 {
+	Empty,
+	Queued,
+	Generating,
+	Generated
+};
 
 struct FTerrainChunk {
-	FTerrainChunk(AEndlessTerrain* ParentTerrain, FIntPoint ChunkCoord, float Size);
+	FTerrainChunk(AEndlessTerrain* ParentTerrain, FChunkKey InKey);
 
-	void CreateResources(AEndlessTerrain* ParentTerrain);
+	// Generates the heightfield and texture the first time, after that only rebuilds the mesh for `DesiredLod`
+	// from the retained heightfield. Returns false if `bCancelled` was raised before every stage ran.
+	bool CreateResources(AEndlessTerrain* ParentTerrain, const FChunkBakedParams& Params, const FThreadSafeBool& bCancelled);
 	void UploadTexture(AEndlessTerrain* ParentTerrain);
 	void UploadMesh(AEndlessTerrain* ParentTerrain);
+	// Heightfield and apron from the baked world or tile cache, false if neither has the chunk. Both only hold
+	// level 0 chunks.
+	static bool LoadHeightField(const FChunkBakedParams& Params, FChunkKey Key, FQuantizedHeightfield& OutHeightField, FQuantizedApron& OutApron);
+	// Baked world, tile cache or noise, in that order. Shared by chunk jobs and `UTerrainBakeCommandlet`.
+	static void BuildHeights(const FChunkBakedParams& Params, FChunkKey Key, FQuantizedHeightfield& OutHeightField, FQuantizedApron& OutApron, TArray<float>& OutHeights);
+	// Everything `CreateResources` would compute for the chunk, with the vertex elevations of every step in `LodSteps`.
+	// Classification is skipped unless `bWriteClasses`.
+	static void Bake(const FChunkBakedParams& Params, FIntPoint ChunkCoord, TArrayView<const int> LodSteps, bool bWriteClasses, FBakedChunk& OutChunk);
+
+	// Clears the chunk's mesh sections and gives back its texture slice, the chunk can't be used afterwards
+	void ReleaseResources(AEndlessTerrain* ParentTerrain);
+
+	// Retained heightfield and apron plus any staging buffers still waiting to be uploaded, as of the last job or
+	// upload. A running job resizes the buffers, so the game thread only ever reads what was published.
+	SIZE_T GetCpuMemory() const {
+		return CpuBytes.load(std::memory_order_relaxed);
+	}
+	// Measures the buffers into `GetCpuMemory`, only from whichever thread owns them: the job once it's done
+	// with the chunk, the game thread after uploading
+	void PublishCpuMemory();
+	// Estimate of what was uploaded to the GPU
+	SIZE_T GetGpuMemory() const;
+	SIZE_T GetMemoryFootprint() const {
+		return GetCpuMemory() + GetGpuMemory();
+	}
+
+	// Shows or hides the chunk's sections, skipped if nothing changes. Hiding stamps `GetLastVisibleFrame`.
+	void SetVisible(AEndlessTerrain* ParentTerrain, bool bNewVisible);
+
+	bool IsVisible() const {
+		return bVisible;
+	}
+
+	uint64 GetLastVisibleFrame() const {
+		return LastVisibleFrame;
+	}
 
 	int GetSectionIndex() const {
 		return SectionIndex;
@@ -24,46 +77,123 @@ struct FTerrainChunk {
 		return ReadyToUploadTexture;
 	}
 
-private:
-	void CreateMesh(AEndlessTerrain* ParentTerrain);
-	void UpdateTexture(AEndlessTerrain* ParentTerrain);
+	EChunkState GetState() const {
+		return State;
+	}
+
+	bool HasHeightField() const {
+		return !HeightField.IsEmpty();
+	}
+
+	FChunkKey GetKey() const {
+		return Key;
+	}
+
+	// Only while no job is running for the chunk
+	void SetDesiredLod(EMapLod Lod) {
+		DesiredLod = Lod;
+	}
+
+	// Lod of the last mesh staged, uploaded or waiting to be uploaded
+	EMapLod GetMeshLod() const {
+		return MeshLod;
+	}
+
+	void SetState(EChunkState NewState) {
+		State = NewState;
+	}
+
+	// Start of the latency measured when the mesh is uploaded
+	void MarkRequested() {
+		RequestedTime = FPlatformTime::Seconds();
+	}
 
-	EMapLod MapLod;
-	FIntPoint ChunkCoord;
+	double GetRequestedTime() const {
+		return RequestedTime;
+	}
+
+	bool HasUploadedMesh() const {
+		return UploadedMeshBytes > 0;
+	}
+
+	// Whether classification put any sample in a water layer. Only known once the mesh is uploaded,
+	// chunks without water get no water quad. `bHasWater` is written by the worker, so only read it after the
+	// upload hand-off.
+	bool HasWater() const {
+		return HasUploadedMesh() && bHasWater;
+	}
+
+private:
+	// First generation from noise: heightfield, texture and `DesiredLod` mesh from one `TerrainPipeline` pass
+	void GenerateFused(const FChunkBakedParams& Params);
+	void CreateMesh(TArrayView<const float> Heights, const FChunkBakedParams& Params);
+	// Normals and tangents of the `DesiredLod` vertices from `HeightField` and `Apron`, so they match the neighbors'
+	void CreateNormals(const FChunkBakedParams& Params);
+	// Hands the built mesh over to the game thread and makes its Lod the `MeshLod`
+	void StageMesh();
+	// Grid of the mesh being built, at `DesiredLod`
+	FTerrainGrid MeshGrid() const;
+	// Noise parameters of the chunk at `Key`, over its full resolution grid
+	static FChunkPipelineDesc NoiseDesc(const FChunkBakedParams& Params, FChunkKey Key);
+	FChunkPipelineDesc PipelineDesc(const FChunkBakedParams& Params) const;
+	void UpdateTexture(TArrayView<const float> Heights, const FChunkBakedParams& Params);
+
+	EMapLod DesiredLod;
+	EMapLod MeshLod;
+	FChunkKey Key;
 	FBox2D Rect;
+	// Shard component of the chunk's region, see `AEndlessTerrain::MeshShards`
+	UProceduralMeshComponent* MeshComponent = nullptr;
 	int SectionIndex;
 
-	NoiseMap Noise;
+	// All the chunk keeps of its noise, float heights only exist while a job runs. The apron is sampled once
+	// with the heightfield, so remeshing never goes back to the noise.
+	FQuantizedHeightfield HeightField;
+	FQuantizedApron Apron;
+	bool bHasTexture = false;
+	bool bHasWater = false;
 
-	UMaterialInstanceDynamic* MaterialInstance;
+	// Slice of `AEndlessTerrain::TexturePool`, owned for the chunk's whole lifetime
+	int TextureSlice = INDEX_NONE;
 
+	// Staging buffers, emptied once uploaded
 	TArray<uint8> TextureData;
-	UTexture2D* Texture;
 
-	// Mesh Data
+	// Mesh Data, decimated to `MeshLod`. Indices are shared by every chunk, see `AEndlessTerrain::GetLodTriangles`
 	TArray<FVector> Vertices;
 	TArray<FVector2D> Uv0;
-	TArray<int32> Triangles;
+	TArray<FVector> Normals;
+	TArray<FProcMeshTangent> Tangents;
 
 	FThreadSafeBool ReadyToUploadMesh = false;
 	FThreadSafeBool ReadyToUploadTexture = false;
-};
 
-struct FAsyncChunkGenerator : public FNonAbandonableTask {
-public:
-	FAsyncChunkGenerator(FTerrainChunk* Chunk, AEndlessTerrain* ParentTerrain) : 
-		Chunk(Chunk), 
-		ParentTerrain(ParentTerrain)
-	{}
+	EChunkState State = EChunkState::Empty;
+
+	bool bVisible = false;
+	uint64 LastVisibleFrame = 0;
+	double RequestedTime = 0.;
+	SIZE_T UploadedTextureBytes = 0;
+	SIZE_T UploadedMeshBytes = 0;
+	std::atomic<SIZE_T> CpuBytes{ sizeof(FTerrainChunk) };
+};
 
-	FORCEINLINE TStatId GetStatId() const {
-		RETURN_QUICK_DECLARE_CYCLE_STAT(FAsyncChunkGenerator, STATGROUP_ThreadPoolAsyncTasks);
+// Mesh component holding the terrain sections and the water section of one region of chunks. Section indices are
+// recycled within the component, so its section count never outgrows the region.
+struct FTerrainMeshShard {
+	UProceduralMeshComponent* Component = nullptr;
+	TArray<int> FreeSections;
+	int NextSection = 0;
+	int NumChunks = 0;
+	int WaterSection = INDEX_NONE;
+
+	int AllocateSection() {
+		return FreeSections.Num() > 0 ? FreeSections.Pop(false) : NextSection++;
 	}
 
-	void DoWork();
-private:
-	FTerrainChunk* Chunk;
-	AEndlessTerrain* ParentTerrain;
+	bool IsUnused() const {
+		return NumChunks == 0 && WaterSection == INDEX_NONE;
+	}
 };
 
 UCLASS()
@@ -72,6 +202,9 @@ class PROCEDURALTERRAIN_API AEndlessTerrain : public AActor
 	GENERATED_BODY()
 
 	friend FTerrainChunk;
+	friend FChunkGenerationScheduler;
+	friend FAsyncChunkGenerator;
+	friend class UTerrainBakeCommandlet;
 
 	// TODO: For now, duplicating a lot of stuff from `ProceduranTerrain`. Will delete that class at some point
 	static constexpr int VerticesInChunk = 241;
@@ -79,6 +212,15 @@ class PROCEDURALTERRAIN_API AEndlessTerrain : public AActor
 	static constexpr float ChunkSize() {
 		return (VerticesInChunk - 1)* TileSize;
 	}
+	// World space area of the chunk, `ChunkSize()` wide and centered on `Coord * ChunkSize()` at level 0
+	static FBox2D ChunkRect(FChunkKey Key) {
+		const FVector2D Min = FVector2D(Key.Coord * Key.Stride()) * ChunkSize() - ChunkSize() / 2.;
+		return FBox2D(Min, Min + Key.Stride() * ChunkSize());
+	}
+	// Noise position of the chunk's first sample, in level 0 samples
+	static FVector2D ChunkNoiseOffset(FChunkKey Key) {
+		return FVector2D(Key.Coord * (Key.Stride() * (VerticesInChunk - 1)));
+	}
 
 	UPROPERTY(EditAnywhere)
 	float Scale;
@@ -88,46 +230,213 @@ class PROCEDURALTERRAIN_API AEndlessTerrain : public AActor
 	float Persistance;
 	UPROPERTY(EditAnywhere)
 	float Lacunarity;
+	// Changing it invalidates the tile cache and baked worlds made with another backend
+	UPROPERTY(EditAnywhere)
+	ETerrainNoiseBackend NoiseBackend;
+	// Replaces the plain fBm above when not empty: nodes can only read earlier nodes, the last one is the height.
+	// `Scale` and `RandomSeed` still apply.
+	UPROPERTY(EditAnywhere)
+	TArray<FTerrainNoiseNode> NoiseGraph;
+	// Splits each chunk's noise rows over worker threads, output does not change
+	UPROPERTY(EditAnywhere)
+	bool bParallelNoise;
 
 	UPROPERTY(EditAnywhere)
 	int ChunksInViewDistance;
+	// Grid keeps `ChunksInViewDistance` chunks around the player. Clipmap splits the view into `ClipmapLevels`
+	// nested levels, each reaching `ChunksInViewDistance` of its own, twice as wide, chunks out: the view distance
+	// doubles with every level while each level adds about as many chunks, vertices and jobs as the first.
+	UPROPERTY(EditAnywhere)
+	ETerrainLayout Layout;
+	UPROPERTY(EditAnywhere, meta = (ClampMin = "1", ClampMax = "10", EditCondition = "Layout == ETerrainLayout::Clipmap"))
+	int ClipmapLevels;
+	// Chunks generated at the same time, nearest to the player first
+	UPROPERTY(EditAnywhere)
+	int MaxConcurrentChunkJobs;
+	UPROPERTY(VisibleInstanceOnly, Transient)
+	int QueuedChunkJobs;
+	UPROPERTY(VisibleInstanceOnly, Transient)
+	int InFlightChunkJobs;
+
+	// Game thread time spent uploading finished chunks each frame, nearest first. Whatever doesn't fit waits for
+	// the next frame, at least one chunk is uploaded per frame.
+	UPROPERTY(EditAnywhere, meta = (ClampMin = "0"))
+	float UploadBudgetMs;
+	UPROPERTY(VisibleInstanceOnly, Transient)
+	int PendingChunkUploads;
+	// Pushed by workers once a chunk has something to upload, drained on the game thread
+	TQueue<FChunkHandle, EQueueMode::Mpsc> CompletedChunks;
+	// Drained from `CompletedChunks` but not uploaded yet
+	TArray<FChunkHandle> PendingUploads;
+
+	// Milliseconds from queueing a chunk's job to uploading its mesh, split by whether the chunk had a mesh before
+	FHistogram ChunkVisibleLatency;
+	FHistogram RemeshLatency;
+
+	// Chunks are sharded over one mesh component per `RegionChunks` squared block, so creating, hiding or
+	// clearing a section only rebuilds the proxy of its region instead of one holding every chunk ever generated.
+	// Components of regions with no chunks left go back to `IdleShardComponents`.
+	static constexpr int RegionChunks = 4;
+	TMap<FChunkKey, FTerrainMeshShard> MeshShards;
+	// Every shard component ever created, active or idle
+	UPROPERTY(Transient)
+	TArray<UProceduralMeshComponent*> ShardComponents;
+	TArray<UProceduralMeshComponent*> IdleShardComponents;
+	UPROPERTY(VisibleInstanceOnly, Transient)
+	int ActiveMeshShards;
+
+	// Water is one section per region, holding a quad per run of wet visible chunks. Regions are rebuilt when a
+	// wet chunk is shown, hidden, released or first uploaded, so in practice when the view ring moves.
+	TSet<FChunkKey> DirtyWaterRegions;
+	UPROPERTY(VisibleInstanceOnly, Transient)
+	int WaterSections;
+
+	// Once resident chunks use more than this, the least recently visible ones outside
+	// `ChunksInViewDistance + EvictionHysteresis` chunks of their level are released
+	UPROPERTY(EditAnywhere)
+	float ChunkMemoryBudgetMB;
+	UPROPERTY(EditAnywhere)
+	int EvictionHysteresis;
+	UPROPERTY(VisibleInstanceOnly, Transient)
+	float ResidentChunkMemoryMB;
+
+	// Slices in the shared chunk texture array, raised to cover `ChunksInViewDistance + EvictionHysteresis` on
+	// every level.
+	// Once all are taken the least recently visible chunk outside that distance is evicted.
+	UPROPERTY(EditAnywhere)
+	int MaxChunkTextures;
+	// Slices of evicted chunks are handed to the next chunk that needs one
+	UPROPERTY(Transient)
+	FChunkTexturePool TexturePool;
+	UPROPERTY(VisibleInstanceOnly, Transient)
+	float TextureAllocationsPerSecond;
+	UPROPERTY(VisibleInstanceOnly, Transient)
+	int64 TextureUploadBytesLastFrame;
 
 	FCriticalSection MeshMutex;
+	// Root only, chunk sections live on `ShardComponents`
 	UPROPERTY(VisibleAnywhere)
 	UProceduralMeshComponent* Mesh;
 	UPROPERTY(VisibleAnywhere)
 	UMaterial* Material;
-	UPROPERTY(VisibleAnywhere)
-	UProceduralMeshComponent* WaterMesh;
+	// Shared by every terrain section, chunks pick their slice of "ChunkTextures" through UV1
+	UPROPERTY(Transient)
+	UMaterialInstanceDynamic* MaterialInstance;
 	UPROPERTY(VisibleAnywhere)
 	UMaterial* WaterMaterial;
 
 	UPROPERTY(EditAnywhere)
 	TArray<FTerrainParams> TerrainParams;
 	UPROPERTY(EditAnywhere)
+	ETerrainTextureFormat TextureFormat;
+	// Used by the terrain material in `ETerrainTextureFormat::PaletteIndex`
+	UPROPERTY(Transient)
+	UTexture2D* PaletteTexture;
+	UPROPERTY(EditAnywhere)
 	float ElevationMultiplier;
 	UPROPERTY(EditAnywhere)
 	UCurveFloat* ElevationCurve;
+	// Entries `ElevationCurve` is baked into, chunk jobs only ever read the baked table
+	UPROPERTY(EditAnywhere, meta = (ClampMin = "2"))
+	int ElevationLutResolution;
+
+	// Heightfields of previously generated chunks, shared by every session with the same generation parameters
+	UPROPERTY(EditAnywhere)
+	bool bUseTileCache;
+	UPROPERTY(EditAnywhere)
+	float TileCacheSizeMB;
+	UPROPERTY(VisibleInstanceOnly, Transient)
+	int64 TileCacheHits;
+	UPROPERTY(VisibleInstanceOnly, Transient)
+	int64 TileCacheMisses;
+	TSharedPtr<FTerrainTileCache, ESPMode::ThreadSafe> TileCache;
+	// Covers everything a chunk's heightfield depends on
+	uint64 GenerationParamsHash() const;
+
+	// Written by `UTerrainBakeCommandlet`, chunks inside it are loaded instead of generated
+	UPROPERTY(EditAnywhere)
+	FFilePath BakedWorldFile;
+	TSharedPtr<const FBakedWorldReader, ESPMode::ThreadSafe> BakedWorld;
+	FString BakedWorldPath;
+
+	TSharedPtr<const FChunkBakedParams, ESPMode::ThreadSafe> BakedParams;
+	// Everything that doesn't need the world: noise parameters and the elevation and classification tables
+	void FillBakedParams(FChunkBakedParams& Params) const;
+	void BakeParams();
 
 	UPROPERTY(EditAnywhere)
 	int RandomSeed;
 	FRandomStream RandomStream;
 
-	TMap<FIntPoint, FTerrainChunk> TerrainMap;
-
-	TArray<FIntPoint> ChunksVisibleLastFrame;
+	// Chunks never move once allocated, everything outside the game thread refers to them by handle
+	TChunkPool<FTerrainChunk> ChunkPool;
+	TMap<FChunkKey, FChunkHandle> TerrainMap;
+
+	// Chunks within `ChunksInViewDistance` of `RingOrigin`, or the clipmap levels' chunks around it, only
+	// recomputed when the player enters another chunk
+	TArray<FChunkKey> ChunksInRing;
+	FIntPoint RingOrigin = FIntPoint(0, 0);
+	int RingRadius = INDEX_NONE;
+	int RingLevels = 0;
+	// Ring chunks still waiting on a free texture, a running job or an upload before their Lod can be settled,
+	// revisited every frame
+	TArray<FChunkKey> UnsettledChunks;
+	// Chunks that left the ring but stay shown until every ring chunk overlapping them has a mesh, so switching
+	// levels doesn't open holes. Always empty on a grid, where ring chunks never overlap.
+	TArray<FChunkKey> FadingChunks;
+
+	FChunkGenerationScheduler Scheduler;
+
+	// One index buffer per `EMapLod`, indexed by its step size and built on first use
+	TStaticArray<TArray<int32>, static_cast<int>(EMapLod::Twelve) + 1> LodTriangles;
+	const TArray<int32>& GetLodTriangles(EMapLod Lod);
+
+	int NumLevels() const {
+		return Layout == ETerrainLayout::Clipmap ? FMath::Clamp(ClipmapLevels, 1, 10) : 1;
+	}
 
+	FTerrainChunk* FindChunk(FChunkKey Key);
 	void UpdateVisibleChunks();
+	// Hides the chunks that left the ring, and creates, shows and re-Lods the ones in it
+	void UpdateRing(FIntPoint OriginChunkCoord);
+	// Appends the leaves of `Key`'s quadtree: chunks close enough to the origin are replaced by their four children
+	// a level down, so every leaf is within `ChunksInViewDistance` chunks of its own level
+	void CollectClipmapRing(FChunkKey Key, FIntPoint OriginChunkCoord, TArray<FChunkKey>& OutChunks) const;
+	// Creates the chunk or queues the job its Lod needs, false if that has to be retried later
+	bool SettleChunk(FChunkKey Key, FIntPoint OriginChunkCoord);
+	// Hides the fading chunks whose area the ring has covered since
+	void UpdateFadingChunks();
+	void UploadCompletedChunks(FIntPoint OriginChunkCoord);
+	// Evicts while over the memory budget or while fewer than `MinFreeTextures` texture slices are free
+	void EvictChunks(FIntPoint OriginChunkCoord, int MinFreeTextures = 0);
+	// Regions are `RegionChunks` squared chunks of one level
+	static FChunkKey RegionOf(FChunkKey Key);
+	// Returns the shard component of the chunk's region and a section on it with the terrain material
+	UProceduralMeshComponent* AllocateSection(FChunkKey Key, int& OutSectionIndex);
+	void FreeSection(FChunkKey Key, int SectionIndex);
+	// Parks the region's component once it holds neither chunks nor water
+	void ReleaseShardIfUnused(FChunkKey Region);
+	void MarkWaterDirty(FChunkKey Key);
+	void UpdateWater();
+	void RebuildWaterRegion(FChunkKey Region);
+
+public:
+	// Logs retained CPU memory and the uploaded GPU estimate of every resident chunk
+	void DumpChunkMemory();
+	// Logs the chunk visible and remesh latency histograms
+	void DumpLatency();
+	// Writes both latency histograms as CSV, one row per bucket. False if the file couldn't be written.
+	bool ExportLatencyCsv(const FString& Path) const;
+	void ResetLatency();
 
 protected:
 	virtual void OnConstruction(const FTransform& Transform) override;
 	virtual void BeginPlay() override;
+	virtual void BeginDestroy() override;
 
 public:
 	AEndlessTerrain();
 	~AEndlessTerrain();
 
-	int CurrSectionIndex() const;
-
 	virtual void Tick(float DeltaTime) override;
 };
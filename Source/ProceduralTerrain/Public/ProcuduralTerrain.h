@@ -4,6 +4,10 @@
 
 #include "CoreMinimal.h"
 #include "NoiseMap.h"
+#include "NoiseGraph.h"
+#include "TerrainTexturing.h"
+#include "ElevationLut.h"
+#include "Curves/CurveFloat.h"
 #include "GameFramework/Actor.h"
 #include "ProceduralMeshComponent.h"
 #include "ProcuduralTerrain.generated.h"
@@ -62,12 +66,174 @@ struct FTerrainParams {
 	FColor Color;
 };
 
+inline TArray<FTerrainLayer> TerrainLayersFromParams(const TArray<FTerrainParams>& Params) {
+	TArray<FTerrainLayer> Layers;
+	Layers.Reserve(Params.Num());
+	for (const FTerrainParams& Param : Params) {
+		Layers.Add(FTerrainLayer{ Param.MaxHeight, Param.Color, Param.Type == ETerrainType::Water });
+	}
+	return Layers;
+}
+
+// Game thread only, `Curve` is a UObject. Without a curve every height gets the full `Multiplier`.
+inline void BakeElevationCurve(FElevationLut& Lut, const UCurveFloat* Curve, FFloatInterval Domain, int Resolution, float Multiplier) {
+	const bool bHasCurve = IsValid(Curve);
+	Lut.Bake([Curve, bHasCurve](float NoiseValue) {
+		return bHasCurve ? Curve->GetFloatValue(NoiseValue) : 1.f;
+	}, Domain, Resolution, Multiplier);
+}
+
+// Mirrors `ENoiseBackend`, which lives in a module without reflection
+UENUM()
+enum class ETerrainNoiseBackend : uint8 {
+	Perlin,
+	// Fewer axis aligned artifacts than Perlin, a little slower
+	OpenSimplex2,
+	// Cheapest, visibly blockier
+	Value
+};
+
+inline ENoiseBackend ToNoiseBackend(ETerrainNoiseBackend Backend) {
+	return static_cast<ENoiseBackend>(Backend);
+}
+
+// Mirrors `ENoiseNodeOp`
+UENUM()
+enum class ETerrainNoiseOp : uint8 {
+	Source,
+	Ridged,
+	Billow,
+	Blend,
+	Curve
+};
+
+// Mirrors `ENoiseBlendMode`
+UENUM()
+enum class ETerrainNoiseBlend : uint8 {
+	Add,
+	Multiply,
+	Min,
+	Max,
+	Lerp
+};
+
+// Editable `FNoiseGraphNode`, see there for what each field does. Node indices are positions in the array.
+USTRUCT()
+struct FTerrainNoiseNode {
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere)
+	ETerrainNoiseOp Op = ETerrainNoiseOp::Source;
+
+	UPROPERTY(EditAnywhere, meta = (EditCondition = "Op == ETerrainNoiseOp::Source", EditConditionHides))
+	ETerrainNoiseBackend Backend = ETerrainNoiseBackend::Perlin;
+	UPROPERTY(EditAnywhere, meta = (EditCondition = "Op == ETerrainNoiseOp::Source", EditConditionHides))
+	int SeedOffset = 0;
+	UPROPERTY(EditAnywhere, meta = (EditCondition = "Op == ETerrainNoiseOp::Source", EditConditionHides, ClampMin = "0.001"))
+	float Frequency = 1.;
+	UPROPERTY(EditAnywhere, meta = (EditCondition = "Op == ETerrainNoiseOp::Source", EditConditionHides, ClampMin = "1"))
+	int Octaves = 1;
+	UPROPERTY(EditAnywhere, meta = (EditCondition = "Op == ETerrainNoiseOp::Source", EditConditionHides))
+	float Persistance = 0.5;
+	UPROPERTY(EditAnywhere, meta = (EditCondition = "Op == ETerrainNoiseOp::Source", EditConditionHides))
+	float Lacunarity = 2.;
+	UPROPERTY(EditAnywhere, meta = (EditCondition = "Op == ETerrainNoiseOp::Source", EditConditionHides))
+	int WarpX = INDEX_NONE;
+	UPROPERTY(EditAnywhere, meta = (EditCondition = "Op == ETerrainNoiseOp::Source", EditConditionHides))
+	int WarpY = INDEX_NONE;
+	// In samples
+	UPROPERTY(EditAnywhere, meta = (EditCondition = "Op == ETerrainNoiseOp::Source", EditConditionHides))
+	float WarpStrength = 0.;
+
+	UPROPERTY(EditAnywhere, meta = (EditCondition = "Op != ETerrainNoiseOp::Source", EditConditionHides))
+	int Input = INDEX_NONE;
+	UPROPERTY(EditAnywhere, meta = (EditCondition = "Op == ETerrainNoiseOp::Blend", EditConditionHides))
+	int Other = INDEX_NONE;
+	UPROPERTY(EditAnywhere, meta = (EditCondition = "Op == ETerrainNoiseOp::Blend", EditConditionHides))
+	int Alpha = INDEX_NONE;
+	UPROPERTY(EditAnywhere, meta = (EditCondition = "Op == ETerrainNoiseOp::Blend", EditConditionHides))
+	ETerrainNoiseBlend BlendMode = ETerrainNoiseBlend::Add;
+	// Over [-1, 1], a missing curve passes the input through
+	UPROPERTY(EditAnywhere, meta = (EditCondition = "Op == ETerrainNoiseOp::Curve", EditConditionHides))
+	UCurveFloat* Curve = nullptr;
+
+	UPROPERTY(EditAnywhere)
+	float OutputScale = 1.;
+	UPROPERTY(EditAnywhere)
+	float OutputBias = 0.;
+};
+
+// Game thread only, curves are UObjects. Returns null for an empty graph, and for an invalid one with the
+// reason in `OutError`.
+inline TSharedPtr<const FNoiseGraph, ESPMode::ThreadSafe> BakeNoiseGraph(const TArray<FTerrainNoiseNode>& Nodes, FString& OutError) {
+	if (Nodes.Num() == 0) {
+		return nullptr;
+	}
+
+	TSharedPtr<FNoiseGraph, ESPMode::ThreadSafe> Graph = MakeShared<FNoiseGraph, ESPMode::ThreadSafe>();
+	Graph->Nodes.SetNum(Nodes.Num());
+	for (int N = 0; N < Nodes.Num(); ++N) {
+		const FTerrainNoiseNode& Node = Nodes[N];
+		FNoiseGraphNode& Out = Graph->Nodes[N];
+		Out.Op = static_cast<ENoiseNodeOp>(Node.Op);
+		Out.Backend = ToNoiseBackend(Node.Backend);
+		Out.SeedOffset = Node.SeedOffset;
+		Out.Frequency = Node.Frequency;
+		Out.Octaves = Node.Octaves;
+		Out.Persistance = Node.Persistance;
+		Out.Lacunarity = Node.Lacunarity;
+		Out.WarpX = Node.WarpX;
+		Out.WarpY = Node.WarpY;
+		Out.WarpStrength = Node.WarpStrength;
+		Out.Input = Node.Input;
+		Out.Other = Node.Other;
+		Out.Alpha = Node.Alpha;
+		Out.BlendMode = static_cast<ENoiseBlendMode>(Node.BlendMode);
+		Out.OutputScale = Node.OutputScale;
+		Out.OutputBias = Node.OutputBias;
+		if (Out.Op == ENoiseNodeOp::Curve) {
+			const UCurveFloat* Curve = IsValid(Node.Curve) ? Node.Curve : nullptr;
+			Out.Curve.Bake([Curve](float Value) {
+				return Curve ? Curve->GetFloatValue(Value) : Value;
+			}, NoiseGraph::CurveDomain(), FElevationLut::DefaultResolution, 1.f);
+		}
+	}
+
+	if (!Graph->Validate(&OutError)) {
+		return nullptr;
+	}
+	return Graph;
+}
+
 UENUM()
 enum class EDisplayTexture : uint8 {
 	Noise,
-	Color
+	Color,
+	// 8 bit layer indices, colored by the material through "PaletteTexture"
+	PaletteIndex
 };
 
+UENUM()
+enum class ETerrainTextureFormat : uint8 {
+	// BGRA colors
+	Color,
+	// 8 bit layer indices, a quarter of the memory and upload size, colored by the material through "PaletteTexture"
+	PaletteIndex
+};
+
+UENUM()
+enum class ETerrainLayout : uint8 {
+	// One level of chunks around the player, Lods by distance
+	Grid,
+	// Nested levels of chunks, each twice as wide as the previous one at half the sample density
+	Clipmap
+};
+
+// `TerrainTexturing::PaletteTextureWidth` x 1 texture holding `Classifier`'s palette
+PROCEDURALTERRAIN_API UTexture2D* CreatePaletteTexture(const FTerrainClassifier& Classifier);
+// Rewrites a texture made by `CreatePaletteTexture` in place
+PROCEDURALTERRAIN_API void UpdatePaletteTexture(UTexture2D* PaletteTexture, const FTerrainClassifier& Classifier);
+
 // TODO: Better way to get like a static array of multiples you can choose from
 UENUM()
 enum class EMapLod : uint8 {
@@ -97,6 +263,8 @@ class PROCEDURALTERRAIN_API AProcuduralTerrain : public AActor
 	UProceduralMeshComponent* Mesh;
 	UPROPERTY(EditAnywhere)
 	UMaterial* Material;
+	// Kept across `OnConstruction` runs, only recreated when `Material` changes
+	UPROPERTY(Transient)
 	UMaterialInstanceDynamic* MaterialInstance;
 
 	static constexpr int ChunkSize = 241;
@@ -108,6 +276,10 @@ class PROCEDURALTERRAIN_API AProcuduralTerrain : public AActor
 	float ElevationMultiplier;
 	UPROPERTY(EditAnywhere)
 	UCurveFloat* ElevationCurve;
+	// Entries `ElevationCurve` is baked into before meshing
+	UPROPERTY(EditAnywhere, meta = (ClampMin = "2"))
+	int ElevationLutResolution;
+	FElevationLut ElevationLut;
 
 	UPROPERTY(EditAnywhere)
 	int RandomSeed;
@@ -121,18 +293,45 @@ class PROCEDURALTERRAIN_API AProcuduralTerrain : public AActor
 	float Lacunarity;
 	UPROPERTY(EditAnywhere)
 	FVector2D NoiseOffset;
+	UPROPERTY(EditAnywhere)
+	ETerrainNoiseBackend NoiseBackend;
+	// Replaces the plain fBm above when not empty, the last node is the height
+	UPROPERTY(EditAnywhere)
+	TArray<FTerrainNoiseNode> NoiseGraph;
+	// Splits the noise rows over worker threads, output does not change
+	UPROPERTY(EditAnywhere)
+	bool bParallelNoise;
 
 	UPROPERTY(EditAnywhere)
 	EDisplayTexture DisplayTexture;
 
 	UPROPERTY(EditAnywhere)
 	TArray<FTerrainParams> TerrainParams;
+	FTerrainClassifier Classifier;
 
 	// TODO: Will use multiple textures
+	// Only recreated when `DisplayTexture` switches between color and index formats
+	UPROPERTY(Transient)
 	UTexture2D* Texture;
+	UPROPERTY(Transient)
+	UTexture2D* PaletteTexture;
+
+	// Inputs each stage last ran with. `OnConstruction` only reruns the stages whose inputs changed,
+	// so editing a color or the elevation doesn't regenerate the noise.
+	uint64 NoiseInputsHash = 0;
+	uint64 ClassifierHash = 0;
+	uint64 ElevationHash = 0;
+	EDisplayTexture TextureDisplay = EDisplayTexture::Noise;
+	EMapLod MeshLod = EMapLod::One;
+	// Indices of `MeshLod`, kept so elevation edits only update vertices
+	TArray<int32> Triangles;
 
-	void CreateMesh();
-	void UpdateTexture();
+	// `bForce` is set when an upstream stage reran, the bool ones return whether their own stage did
+	bool UpdateNoise();
+	bool UpdateClassifier();
+	bool UpdateTexture(bool bForce);
+	void UpdateMesh(bool bForce);
+	void UpdateMaterial();
 public:	
 	AProcuduralTerrain();
 
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "TerrainBakeCommandlet.generated.h"
+
+// Pre-generates a rectangle of `AEndlessTerrain` chunks into a baked world file the terrain loads instead of
+// generating them. Runs headless:
+//   UnrealEditor-Cmd ProceduralTerrain.uproject -run=TerrainBake -MinX=-16 -MinY=-16 -MaxX=15 -MaxY=15
+//     [-Terrain=<actor or class path>] [-Out=<file>] [-Lods=1,2,4] [-NoClasses] [-Batch=256] -unattended -nullrhi
+// Bounds are inclusive chunk coordinates, parameters come from the given terrain or the class defaults.
+UCLASS()
+class UTerrainBakeCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UTerrainBakeCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
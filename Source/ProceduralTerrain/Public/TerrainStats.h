@@ -0,0 +1,34 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+
+// Per chunk messages are Verbose, enable them with `log LogProceduralTerrain Verbose`
+PROCEDURALTERRAIN_API DECLARE_LOG_CATEGORY_EXTERN(LogProceduralTerrain, Log, All);
+
+// `stat ProceduralTerrain`
+DECLARE_STATS_GROUP(TEXT("ProceduralTerrain"), STATGROUP_ProceduralTerrain, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Noise"), STAT_TerrainNoise, STATGROUP_ProceduralTerrain, PROCEDURALTERRAIN_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Fused generation"), STAT_TerrainFusedGeneration, STATGROUP_ProceduralTerrain, PROCEDURALTERRAIN_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Classification"), STAT_TerrainClassification, STATGROUP_ProceduralTerrain, PROCEDURALTERRAIN_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Meshing"), STAT_TerrainMeshing, STATGROUP_ProceduralTerrain, PROCEDURALTERRAIN_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Normals"), STAT_TerrainNormals, STATGROUP_ProceduralTerrain, PROCEDURALTERRAIN_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Texture upload"), STAT_TerrainTextureUpload, STATGROUP_ProceduralTerrain, PROCEDURALTERRAIN_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Mesh upload"), STAT_TerrainMeshUpload, STATGROUP_ProceduralTerrain, PROCEDURALTERRAIN_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("View ring"), STAT_TerrainViewRing, STATGROUP_ProceduralTerrain, PROCEDURALTERRAIN_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Eviction"), STAT_TerrainEviction, STATGROUP_ProceduralTerrain, PROCEDURALTERRAIN_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Water"), STAT_TerrainWater, STATGROUP_ProceduralTerrain, PROCEDURALTERRAIN_API);
+
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Queued jobs"), STAT_TerrainQueuedJobs, STATGROUP_ProceduralTerrain, PROCEDURALTERRAIN_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("In flight jobs"), STAT_TerrainInFlightJobs, STATGROUP_ProceduralTerrain, PROCEDURALTERRAIN_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Pending uploads"), STAT_TerrainPendingUploads, STATGROUP_ProceduralTerrain, PROCEDURALTERRAIN_API);
+
+// Also captured by `csvprofile start` / `-csvCaptureFrames=N`, which works in headless (-nullrhi) runs
+CSV_DECLARE_CATEGORY_MODULE_EXTERN(PROCEDURALTERRAIN_API, ProceduralTerrain);
+
+// Times the enclosing scope as both `STAT_Terrain<Name>` and the CSV timing stat `ProceduralTerrain/<Name>`
+#define TERRAIN_SCOPED_STAT(Name) \
+	SCOPE_CYCLE_COUNTER(STAT_Terrain##Name); \
+	CSV_SCOPED_TIMING_STAT(ProceduralTerrain, Name)
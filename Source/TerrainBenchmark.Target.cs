@@ -0,0 +1,26 @@
+using UnrealBuildTool;
+using System.Collections.Generic;
+
+// Headless benchmark for TerrainCore, no engine or GPU needed:
+//   Engine/Build/BatchFiles/RunUAT.sh BuildTarget -project=ProceduralTerrain.uproject -target=TerrainBenchmark -platform=Linux -configuration=Development
+//   Binaries/Linux/TerrainBenchmark -stdout [-Iterations=N] [-Kernels]
+[SupportedPlatforms(UnrealPlatformClass.Desktop)]
+public class TerrainBenchmarkTarget : TargetRules
+{
+	public TerrainBenchmarkTarget(TargetInfo Target) : base(Target)
+	{
+		Type = TargetType.Program;
+		LinkType = TargetLinkType.Monolithic;
+		DefaultBuildSettings = BuildSettingsVersion.V4;
+		IncludeOrderVersion = EngineIncludeOrderVersion.Unreal5_3;
+		LaunchModuleName = "TerrainBenchmark";
+
+		bBuildDeveloperTools = false;
+		bCompileAgainstEngine = false;
+		bCompileAgainstCoreUObject = false;
+		bCompileAgainstApplicationCore = false;
+		bCompileICU = false;
+		bBuildWithEditorOnlyData = false;
+		bIsBuildingConsoleApplication = true;
+	}
+}
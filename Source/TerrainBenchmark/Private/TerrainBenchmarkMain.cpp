@@ -0,0 +1,30 @@
+#include "RequiredProgramMainCPPInclude.h"
+#include "TerrainBenchmark.h"
+
+IMPLEMENT_APPLICATION(TerrainBenchmark, "TerrainBenchmark");
+
+INT32_MAIN_INT32_ARGC_TCHAR_ARGV()
+{
+	FTaskTagScope Scope(ETaskTag::EGameThread);
+	ON_SCOPE_EXIT
+	{
+		RequestEngineExit(TEXT("TerrainBenchmark exiting"));
+		FEngineLoop::AppPreExit();
+		FModuleManager::Get().UnloadModulesAtShutdown();
+		FEngineLoop::AppExit();
+	};
+
+	if (const int32 Ret = GEngineLoop.PreInit(ArgC, ArgV)) {
+		return Ret;
+	}
+
+	FTerrainBenchmarkConfig Config;
+	FParse::Value(FCommandLine::Get(), TEXT("-Iterations="), Config.Iterations);
+
+	if (FParse::Param(FCommandLine::Get(), TEXT("Kernels"))) {
+		TerrainBenchmark::RunNoiseKernels(241, 8, Config.Iterations);
+	}
+	TerrainBenchmark::LogResults(TerrainBenchmark::RunSuite(Config));
+
+	return 0;
+}
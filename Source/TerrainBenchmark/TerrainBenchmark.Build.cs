@@ -0,0 +1,14 @@
+using System.IO;
+using UnrealBuildTool;
+
+public class TerrainBenchmark : ModuleRules
+{
+	public TerrainBenchmark(ReadOnlyTargetRules Target) : base(Target)
+	{
+		PublicIncludePaths.Add(Path.Combine(EngineDirectory, "Source/Runtime/Launch/Public"));
+		// For LaunchEngineLoop.cpp, pulled in through RequiredProgramMainCPPInclude.h
+		PrivateIncludePaths.Add(Path.Combine(EngineDirectory, "Source/Runtime/Launch/Private"));
+
+		PrivateDependencyModuleNames.AddRange(new string[] { "Core", "Projects", "TerrainCore" });
+	}
+}
@@ -0,0 +1,25 @@
+#include "ElevationLut.h"
+#include "Hash/CityHash.h"
+
+void FElevationLut::Bake(TFunctionRef<float(float)> Curve, FFloatInterval Domain, int Resolution, float Multiplier) {
+	check(Domain.Max > Domain.Min);
+	Resolution = FMath::Max(Resolution, 2);
+
+	const float Step = (Domain.Max - Domain.Min) / (Resolution - 1);
+	DomainMin = Domain.Min;
+	InvStep = 1. / Step;
+	MaxIndex = Resolution - 1;
+
+	Values.SetNumUninitialized(Resolution + 1);
+	for (int I = 0; I < Resolution; ++I) {
+		Values[I] = Curve(Domain.Min + I * Step) * Multiplier;
+	}
+	Values[Resolution] = Values[Resolution - 1];
+}
+
+uint64 FElevationLut::GetHash() const {
+	const float Domain[] = { DomainMin, InvStep };
+	uint64 Hash = CityHash64(reinterpret_cast<const char*>(Domain), sizeof(Domain));
+	Hash = CityHash64WithSeed(reinterpret_cast<const char*>(Values.GetData()), Values.Num() * sizeof(float), Hash);
+	return Hash != 0 ? Hash : 1;
+}
@@ -0,0 +1,248 @@
+#include "NoiseGraph.h"
+#include "Hash/CityHash.h"
+
+namespace {
+	bool IsEarlierNode(int Index, int NodeIndex) {
+		return Index >= 0 && Index < NodeIndex;
+	}
+}
+
+bool FNoiseGraph::Validate(FString* OutError) const {
+	auto Fail = [OutError](int NodeIndex, const TCHAR* Reason) {
+		if (OutError) {
+			*OutError = FString::Printf(TEXT("Noise node %d: %s"), NodeIndex, Reason);
+		}
+		return false;
+	};
+
+	for (int N = 0; N < Nodes.Num(); ++N) {
+		const FNoiseGraphNode& Node = Nodes[N];
+		switch (Node.Op) {
+			case ENoiseNodeOp::Source: {
+				if (Node.Octaves < 1 || Node.Frequency <= 0.) {
+					return Fail(N, TEXT("sources need at least one octave and a positive frequency"));
+				}
+				if ((Node.WarpX != INDEX_NONE && !IsEarlierNode(Node.WarpX, N)) || (Node.WarpY != INDEX_NONE && !IsEarlierNode(Node.WarpY, N))) {
+					return Fail(N, TEXT("warps can only read earlier nodes"));
+				}
+				break;
+			}
+			case ENoiseNodeOp::Ridged:
+			case ENoiseNodeOp::Billow:
+			case ENoiseNodeOp::Curve: {
+				if (!IsEarlierNode(Node.Input, N)) {
+					return Fail(N, TEXT("input has to be an earlier node"));
+				}
+				if (Node.Op == ENoiseNodeOp::Curve && Node.Curve.IsEmpty()) {
+					return Fail(N, TEXT("curve isn't baked"));
+				}
+				break;
+			}
+			case ENoiseNodeOp::Blend: {
+				if (!IsEarlierNode(Node.Input, N) || !IsEarlierNode(Node.Other, N)) {
+					return Fail(N, TEXT("blend inputs have to be earlier nodes"));
+				}
+				if (Node.BlendMode == ENoiseBlendMode::Lerp && !IsEarlierNode(Node.Alpha, N)) {
+					return Fail(N, TEXT("lerp alpha has to be an earlier node"));
+				}
+				break;
+			}
+			default: {
+				return Fail(N, TEXT("unknown op"));
+			}
+		}
+	}
+	return true;
+}
+
+uint64 FNoiseGraph::GetHash() const {
+	const int32 NumNodes = Nodes.Num();
+	uint64 Hash = CityHash64(reinterpret_cast<const char*>(&NumNodes), sizeof(NumNodes));
+	for (const FNoiseGraphNode& Node : Nodes) {
+		// Only 4 byte members, so there's no padding to hash
+		const struct {
+			uint32 Op;
+			uint32 Backend;
+			int32 SeedOffset;
+			float Frequency;
+			int32 Octaves;
+			float Persistance;
+			float Lacunarity;
+			int32 WarpX;
+			int32 WarpY;
+			float WarpStrength;
+			int32 Input;
+			int32 Other;
+			int32 Alpha;
+			uint32 BlendMode;
+			float OutputScale;
+			float OutputBias;
+		} Key = {
+			static_cast<uint32>(Node.Op),
+			static_cast<uint32>(Node.Backend),
+			Node.SeedOffset,
+			Node.Frequency,
+			Node.Octaves,
+			Node.Persistance,
+			Node.Lacunarity,
+			Node.WarpX,
+			Node.WarpY,
+			Node.WarpStrength,
+			Node.Input,
+			Node.Other,
+			Node.Alpha,
+			static_cast<uint32>(Node.BlendMode),
+			Node.OutputScale,
+			Node.OutputBias
+		};
+		Hash = CityHash64WithSeed(reinterpret_cast<const char*>(&Key), sizeof(Key), Hash);
+		if (Node.Op == ENoiseNodeOp::Curve) {
+			const uint64 CurveHash = Node.Curve.GetHash();
+			Hash = CityHash64WithSeed(reinterpret_cast<const char*>(&CurveHash), sizeof(CurveHash), Hash);
+		}
+	}
+	return Hash != 0 ? Hash : 1;
+}
+
+void FNoiseGraphSampler::Init(const FNoiseGraph& InGraph, int Seed, int InWidth, int InHeight, float Scale, FVector2D NoiseOffset, float InSampleSpacing) {
+	check(InGraph.Validate() && !InGraph.IsEmpty());
+	Graph = &InGraph;
+	Width = InWidth;
+	Height = InHeight;
+	SampleSpacing = InSampleSpacing;
+
+	Sources.Reset();
+	Sources.SetNum(InGraph.Nodes.Num());
+	SourceNormalizers.SetNumZeroed(InGraph.Nodes.Num());
+	for (int N = 0; N < InGraph.Nodes.Num(); ++N) {
+		const FNoiseGraphNode& Node = InGraph.Nodes[N];
+		if (Node.Op == ENoiseNodeOp::Source) {
+			Sources[N].Init(Seed + Node.SeedOffset, Width, Height, Scale / Node.Frequency, Node.Octaves, Node.Persistance, Node.Lacunarity, NoiseOffset, Node.Backend, SampleSpacing);
+			SourceNormalizers[N] = 1. / Sources[N].GlobalBounds().Max;
+		}
+	}
+}
+
+void FNoiseGraphSampler::SumRow(ENoiseKernel Kernel, int Y, float* OutRow) const {
+	// Every node's tile plus the warped positions
+	TArray<float, TInlineAllocator<TileWidth * 16>> Scratch;
+	Scratch.SetNumUninitialized((Graph->Nodes.Num() + 2) * TileWidth);
+	for (int FirstX = 0; FirstX < Width; FirstX += TileWidth) {
+		EvaluateTile(Kernel, Y, FirstX, nullptr, FMath::Min(TileWidth, Width - FirstX), Scratch.GetData(), OutRow + FirstX);
+	}
+}
+
+void FNoiseGraphSampler::SumColumns(ENoiseKernel Kernel, int Y, TArrayView<const int> Columns, float* Out) const {
+	TArray<float, TInlineAllocator<TileWidth * 16>> Scratch;
+	Scratch.SetNumUninitialized((Graph->Nodes.Num() + 2) * TileWidth);
+	for (int First = 0; First < Columns.Num(); First += TileWidth) {
+		EvaluateTile(Kernel, Y, 0, Columns.GetData() + First, FMath::Min(TileWidth, Columns.Num() - First), Scratch.GetData(), Out + First);
+	}
+}
+
+void FNoiseGraphSampler::EvaluateTile(ENoiseKernel Kernel, int Y, int FirstX, const int* Columns, int Count, float* Scratch, float* Out) const {
+	const TArray<FNoiseGraphNode>& Nodes = Graph->Nodes;
+	float* WarpedXs = Scratch + Nodes.Num() * TileWidth;
+	float* WarpedYs = WarpedXs + TileWidth;
+
+	for (int N = 0; N < Nodes.Num(); ++N) {
+		const FNoiseGraphNode& Node = Nodes[N];
+		float* Values = Scratch + N * TileWidth;
+		const float* Input = Node.Input != INDEX_NONE ? Scratch + Node.Input * TileWidth : nullptr;
+		switch (Node.Op) {
+			case ENoiseNodeOp::Source: {
+				const FNoiseOctaves& Source = Sources[N];
+				if (Node.WarpX != INDEX_NONE || Node.WarpY != INDEX_NONE) {
+					const float* WarpX = Node.WarpX != INDEX_NONE ? Scratch + Node.WarpX * TileWidth : nullptr;
+					const float* WarpY = Node.WarpY != INDEX_NONE ? Scratch + Node.WarpY * TileWidth : nullptr;
+					// Points are in this map's samples, the warp is the same distance in the noise at any spacing
+					const float WarpStrength = Node.WarpStrength / SampleSpacing;
+					for (int I = 0; I < Count; ++I) {
+						const int X = Columns ? Columns[I] : FirstX + I;
+						WarpedXs[I] = X + (WarpX ? WarpX[I] * WarpStrength : 0.f);
+						WarpedYs[I] = Y + (WarpY ? WarpY[I] * WarpStrength : 0.f);
+					}
+					Source.SumPoints(WarpedXs, WarpedYs, Count, Values);
+				}
+				else if (Columns) {
+					Source.SumColumns(Kernel, Y, MakeArrayView(Columns, Count), Values);
+				}
+				else {
+					const FNoiseRowOctaves Octaves{ Source.SampleXs.GetData() + FirstX, Source.Width, Source.SampleYs.GetData() + Y * Source.NumOctaves, Source.Amplitudes.GetData(), Source.NumOctaves };
+					NoiseKernel::SumOctaveRow(Source.Backend, Kernel, Octaves, Values, Count);
+				}
+				const float Normalizer = SourceNormalizers[N];
+				for (int I = 0; I < Count; ++I) {
+					Values[I] *= Normalizer;
+				}
+				break;
+			}
+			case ENoiseNodeOp::Ridged: {
+				for (int I = 0; I < Count; ++I) {
+					Values[I] = 1.f - 2.f * FMath::Abs(Input[I]);
+				}
+				break;
+			}
+			case ENoiseNodeOp::Billow: {
+				for (int I = 0; I < Count; ++I) {
+					Values[I] = 2.f * FMath::Abs(Input[I]) - 1.f;
+				}
+				break;
+			}
+			case ENoiseNodeOp::Blend: {
+				const float* Other = Scratch + Node.Other * TileWidth;
+				switch (Node.BlendMode) {
+					case ENoiseBlendMode::Multiply: {
+						for (int I = 0; I < Count; ++I) {
+							Values[I] = Input[I] * Other[I];
+						}
+						break;
+					}
+					case ENoiseBlendMode::Min: {
+						for (int I = 0; I < Count; ++I) {
+							Values[I] = FMath::Min(Input[I], Other[I]);
+						}
+						break;
+					}
+					case ENoiseBlendMode::Max: {
+						for (int I = 0; I < Count; ++I) {
+							Values[I] = FMath::Max(Input[I], Other[I]);
+						}
+						break;
+					}
+					case ENoiseBlendMode::Lerp: {
+						const float* Alpha = Scratch + Node.Alpha * TileWidth;
+						for (int I = 0; I < Count; ++I) {
+							Values[I] = FMath::Lerp(Input[I], Other[I], FMath::Clamp(Alpha[I] * 0.5f + 0.5f, 0.f, 1.f));
+						}
+						break;
+					}
+					default: {
+						for (int I = 0; I < Count; ++I) {
+							Values[I] = Input[I] + Other[I];
+						}
+						break;
+					}
+				}
+				break;
+			}
+			case ENoiseNodeOp::Curve: {
+				for (int I = 0; I < Count; ++I) {
+					Values[I] = Node.Curve.Sample(Input[I]);
+				}
+				break;
+			}
+			default: {
+				checkNoEntry();
+				break;
+			}
+		}
+
+		if (Node.OutputScale != 1.f || Node.OutputBias != 0.f) {
+			for (int I = 0; I < Count; ++I) {
+				Values[I] = Values[I] * Node.OutputScale + Node.OutputBias;
+			}
+		}
+	}
+	FMemory::Memcpy(Out, Scratch + (Nodes.Num() - 1) * TileWidth, Count * sizeof(float));
+}
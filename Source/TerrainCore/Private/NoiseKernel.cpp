@@ -0,0 +1,703 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "NoiseKernel.h"
+#include "Math/UnrealMathUtility.h"
+#include "Math/RandomStream.h"
+#include <utility>
+
+#if PLATFORM_CPU_X86_FAMILY
+	#include <immintrin.h>
+	#if defined(_MSC_VER) && !defined(__clang__)
+		#include <intrin.h>
+		#define NOISE_TARGET_SSE4
+		#define NOISE_TARGET_AVX2
+	#else
+		#include <cpuid.h>
+		#define NOISE_TARGET_SSE4 __attribute__((target("sse4.1")))
+		#define NOISE_TARGET_AVX2 __attribute__((target("avx2")))
+	#endif
+#endif
+
+namespace {
+	// Lattice is 256x256, plus padding so the AVX2 path can gather 4 bytes at the last entry
+	constexpr int GradientTableSize = 256 * 256;
+
+	// Gradient of each lattice corner packed as (GX + 1) | ((GY + 1) << 2), with GX, GY in {-1, 0, 1}.
+	// `FMath::PerlinNoise2D` only ever uses `P[P[Xi] + Yi] & 7` to pick a gradient, so the gradient
+	// depends on the corner alone. Probing just off each corner along X and Y gives both components.
+	struct FGradientTable {
+		uint8 Codes[GradientTableSize + 4];
+
+		FGradientTable() {
+			FMemory::Memzero(Codes);
+			const float Epsilon = 1. / 64.;
+			for (int Yi = 0; Yi < 256; ++Yi) {
+				for (int Xi = 0; Xi < 256; ++Xi) {
+					const float DX = FMath::PerlinNoise2D(FVector2D(Xi + Epsilon, Yi));
+					const float DY = FMath::PerlinNoise2D(FVector2D(Xi, Yi + Epsilon));
+					const int GX = FMath::Clamp(FMath::RoundToInt(DX / Epsilon), -1, 1);
+					const int GY = FMath::Clamp(FMath::RoundToInt(DY / Epsilon), -1, 1);
+					Codes[(Yi << 8) | Xi] = static_cast<uint8>((GX + 1) | ((GY + 1) << 2));
+				}
+			}
+		}
+	};
+
+	const uint8* GradientCodes() {
+		static const FGradientTable Table;
+		return Table.Codes;
+	}
+
+	FORCEINLINE float SmoothCurve(float X) {
+		return X * X * X * (X * (X * 6.0f - 15.0f) + 10.0f);
+	}
+
+	FORCEINLINE float Grad(uint8 Code, float X, float Y) {
+		const float GX = static_cast<float>(Code & 3) - 1.0f;
+		const float GY = static_cast<float>(Code >> 2) - 1.0f;
+		return GX * X + GY * Y;
+	}
+
+	void AccumulateRowReference(const float* SampleX, float SampleY, float Amplitude, float* Heights, int Count) {
+		for (int I = 0; I < Count; ++I) {
+			const float Noise = FMath::PerlinNoise2D(FVector2D(SampleX[I], SampleY)) * 2. - 1.;
+			Heights[I] += Noise * Amplitude;
+		}
+	}
+
+	// Scalar backends. `PrepareRow` computes whatever only depends on the row's Y once, `Sample` does the rest.
+	struct FPerlinNoise {
+		struct FRow {
+			const uint8* Codes;
+			int32 Row0;
+			int32 Row1;
+			float Y;
+			float Ym1;
+			float V;
+		};
+
+		static FRow PrepareRow(float SampleY) {
+			const float Yfl = FMath::FloorToFloat(SampleY);
+			const float Y = SampleY - Yfl;
+			return FRow{ GradientCodes(), ((int32)Yfl & 255) << 8, (((int32)Yfl + 1) & 255) << 8, Y, Y - 1.0f, SmoothCurve(Y) };
+		}
+
+		static FORCEINLINE float Sample(const FRow& Row, float SampleX) {
+			const float Xfl = FMath::FloorToFloat(SampleX);
+			const int32 Xi0 = (int32)Xfl & 255;
+			const int32 Xi1 = ((int32)Xfl + 1) & 255;
+			const float X = SampleX - Xfl;
+			const float Xm1 = X - 1.0f;
+			const float U = SmoothCurve(X);
+
+			const uint8* Codes = Row.Codes;
+			return FMath::Lerp(
+				FMath::Lerp(Grad(Codes[Row.Row0 | Xi0], X, Row.Y), Grad(Codes[Row.Row0 | Xi1], Xm1, Row.Y), U),
+				FMath::Lerp(Grad(Codes[Row.Row1 | Xi0], X, Row.Ym1), Grad(Codes[Row.Row1 | Xi1], Xm1, Row.Ym1), U),
+				Row.V
+			) * 2.0f - 1.0f;
+		}
+	};
+
+	// The fast 2D variant of OpenSimplex2 (public domain, KdotJPG) with seed 0. Gradients are 128 evenly spaced
+	// directions rather than the reference table, scaled by the same normalizer so the output spans about [-1, 1].
+	struct FOpenSimplex2Noise {
+		static constexpr uint64 PrimeX = 0x5205402B9270C86Full;
+		static constexpr uint64 PrimeY = 0x598CD327003817B5ull;
+		static constexpr uint64 HashMultiplier = 0x53A3F72DEEC546F5ull;
+		static constexpr double Skew = 0.366025403784439;
+		static constexpr double Unskew = -0.21132486540518713;
+		static constexpr float RSquared = 0.5f;
+		static constexpr float Normalizer = 0.01001634121365712f;
+		static constexpr int GradientExponent = 7;
+		static constexpr int NumGradients = 1 << GradientExponent;
+
+		struct FGradients {
+			float Values[NumGradients * 2];
+
+			FGradients() {
+				for (int I = 0; I < NumGradients; ++I) {
+					const double Angle = (I + 0.5) * UE_DOUBLE_TWO_PI / NumGradients;
+					Values[I * 2] = static_cast<float>(FMath::Cos(Angle) / Normalizer);
+					Values[I * 2 + 1] = static_cast<float>(FMath::Sin(Angle) / Normalizer);
+				}
+			}
+		};
+
+		struct FRow {
+			const float* Gradients;
+			float Y;
+		};
+
+		static FRow PrepareRow(float SampleY) {
+			static const FGradients Gradients;
+			return FRow{ Gradients.Values, SampleY };
+		}
+
+		static FORCEINLINE float Grad(const float* Gradients, uint64 XPrimed, uint64 YPrimed, float DX, float DY) {
+			uint64 Hash = (XPrimed ^ YPrimed) * HashMultiplier;
+			Hash ^= Hash >> (64 - GradientExponent + 1);
+			const int Index = static_cast<int>(Hash) & ((NumGradients - 1) << 1);
+			return Gradients[Index] * DX + Gradients[Index | 1] * DY;
+		}
+
+		static FORCEINLINE float Contribution(float A, float Gradient) {
+			return A > 0.f ? (A * A) * (A * A) * Gradient : 0.f;
+		}
+
+		static FORCEINLINE float Sample(const FRow& Row, float SampleX) {
+			// Skewed in double, like the reference, so large octave offsets keep their fractional part
+			const double S = Skew * (static_cast<double>(SampleX) + Row.Y);
+			const double Xs = SampleX + S;
+			const double Ys = Row.Y + S;
+			const double Xsb = FMath::FloorToDouble(Xs);
+			const double Ysb = FMath::FloorToDouble(Ys);
+			const float Xi = static_cast<float>(Xs - Xsb);
+			const float Yi = static_cast<float>(Ys - Ysb);
+			const uint64 XsbP = static_cast<uint64>(static_cast<int64>(Xsb)) * PrimeX;
+			const uint64 YsbP = static_cast<uint64>(static_cast<int64>(Ysb)) * PrimeY;
+
+			const float T = (Xi + Yi) * static_cast<float>(Unskew);
+			const float DX0 = Xi + T;
+			const float DY0 = Yi + T;
+
+			const float A0 = RSquared - DX0 * DX0 - DY0 * DY0;
+			float Value = Contribution(A0, Grad(Row.Gradients, XsbP, YsbP, DX0, DY0));
+
+			constexpr float A1Slope = static_cast<float>(2 * (1 + 2 * Unskew) * (1 / Unskew + 2));
+			constexpr float A1Offset = static_cast<float>(-2 * (1 + 2 * Unskew) * (1 + 2 * Unskew));
+			constexpr float Diagonal = static_cast<float>(1 + 2 * Unskew);
+			const float A1 = A1Slope * T + (A1Offset + A0);
+			if (A1 > 0.f) {
+				Value += Contribution(A1, Grad(Row.Gradients, XsbP + PrimeX, YsbP + PrimeY, DX0 - Diagonal, DY0 - Diagonal));
+			}
+
+			if (DY0 > DX0) {
+				const float DX2 = DX0 - static_cast<float>(Unskew);
+				const float DY2 = DY0 - static_cast<float>(Unskew + 1);
+				Value += Contribution(RSquared - DX2 * DX2 - DY2 * DY2, Grad(Row.Gradients, XsbP, YsbP + PrimeY, DX2, DY2));
+			}
+			else {
+				const float DX2 = DX0 - static_cast<float>(Unskew + 1);
+				const float DY2 = DY0 - static_cast<float>(Unskew);
+				Value += Contribution(RSquared - DX2 * DX2 - DY2 * DY2, Grad(Row.Gradients, XsbP + PrimeX, YsbP, DX2, DY2));
+			}
+			return Value;
+		}
+	};
+
+	// Same 256x256 wrapping lattice as the Perlin table, with a random value per corner instead of a gradient
+	struct FValueNoise {
+		struct FValues {
+			float Values[256 * 256];
+
+			FValues() {
+				FRandomStream RandomStream(0x5EED);
+				for (float& Value : Values) {
+					Value = RandomStream.FRandRange(-1.f, 1.f);
+				}
+			}
+		};
+
+		struct FRow {
+			const float* Values;
+			int32 Row0;
+			int32 Row1;
+			float V;
+		};
+
+		static FRow PrepareRow(float SampleY) {
+			static const FValues Values;
+			const float Yfl = FMath::FloorToFloat(SampleY);
+			return FRow{ Values.Values, ((int32)Yfl & 255) << 8, (((int32)Yfl + 1) & 255) << 8, SmoothCurve(SampleY - Yfl) };
+		}
+
+		static FORCEINLINE float Sample(const FRow& Row, float SampleX) {
+			const float Xfl = FMath::FloorToFloat(SampleX);
+			const int32 Xi0 = (int32)Xfl & 255;
+			const int32 Xi1 = ((int32)Xfl + 1) & 255;
+			const float U = SmoothCurve(SampleX - Xfl);
+			return FMath::Lerp(
+				FMath::Lerp(Row.Values[Row.Row0 | Xi0], Row.Values[Row.Row0 | Xi1], U),
+				FMath::Lerp(Row.Values[Row.Row1 | Xi0], Row.Values[Row.Row1 | Xi1], U),
+				Row.V
+			);
+		}
+	};
+
+	using FSumRowFunction = void (*)(const FNoiseRowOctaves& Octaves, float* Heights, int Count);
+
+	// Sum + every octave from `Octave` on, as a chain of inlined calls so the octave loop is fully unrolled.
+	// Adds in octave order, the same as accumulating a row per octave.
+	template<typename NoiseType, int Octave, int NumOctaves>
+	FORCEINLINE float AccumulateOctaves(float Sum, const typename NoiseType::FRow* Rows, const float* Amplitudes, const float* SampleXs, int XStride) {
+		Sum += NoiseType::Sample(Rows[Octave], SampleXs[Octave * XStride]) * Amplitudes[Octave];
+		if constexpr (Octave + 1 < NumOctaves) {
+			return AccumulateOctaves<NoiseType, Octave + 1, NumOctaves>(Sum, Rows, Amplitudes, SampleXs, XStride);
+		}
+		else {
+			return Sum;
+		}
+	}
+
+	template<typename NoiseType, int NumOctaves>
+	void SumRowUnrolled(const FNoiseRowOctaves& Octaves, float* Heights, int Count) {
+		typename NoiseType::FRow Rows[NumOctaves];
+		for (int O = 0; O < NumOctaves; ++O) {
+			Rows[O] = NoiseType::PrepareRow(Octaves.SampleYs[O]);
+		}
+		for (int I = 0; I < Count; ++I) {
+			Heights[I] = AccumulateOctaves<NoiseType, 0, NumOctaves>(0.f, Rows, Octaves.Amplitudes, Octaves.SampleXs + I, Octaves.XStride);
+		}
+	}
+
+	// Any octave count, one pass over the row per octave
+	template<typename NoiseType>
+	void SumRowGeneric(const FNoiseRowOctaves& Octaves, float* Heights, int Count) {
+		FMemory::Memzero(Heights, Count * sizeof(float));
+		for (int O = 0; O < Octaves.NumOctaves; ++O) {
+			const typename NoiseType::FRow Row = NoiseType::PrepareRow(Octaves.SampleYs[O]);
+			const float* SampleX = Octaves.SampleXs + O * Octaves.XStride;
+			for (int I = 0; I < Count; ++I) {
+				Heights[I] += NoiseType::Sample(Row, SampleX[I]) * Octaves.Amplitudes[O];
+			}
+		}
+	}
+
+	template<typename NoiseType, int... Counts>
+	FSumRowFunction SelectUnrolled(int NumOctaves, std::integer_sequence<int, Counts...>) {
+		static constexpr FSumRowFunction Functions[] = { &SumRowUnrolled<NoiseType, Counts + 1>... };
+		return Functions[NumOctaves - 1];
+	}
+
+	template<typename NoiseType>
+	void SumPoints(const FNoisePointOctaves& Octaves, float* Heights, int Count) {
+		FMemory::Memzero(Heights, Count * sizeof(float));
+		for (int O = 0; O < Octaves.NumOctaves; ++O) {
+			const float* SampleX = Octaves.SampleXs + O * Octaves.Stride;
+			const float* SampleY = Octaves.SampleYs + O * Octaves.Stride;
+			for (int I = 0; I < Count; ++I) {
+				Heights[I] += NoiseType::Sample(NoiseType::PrepareRow(SampleY[I]), SampleX[I]) * Octaves.Amplitudes[O];
+			}
+		}
+	}
+
+	void AccumulateRowScalar(const float* SampleX, float SampleY, float Amplitude, float* Heights, int Count) {
+		const FPerlinNoise::FRow Row = FPerlinNoise::PrepareRow(SampleY);
+		for (int I = 0; I < Count; ++I) {
+			Heights[I] += FPerlinNoise::Sample(Row, SampleX[I]) * Amplitude;
+		}
+	}
+
+#if PLATFORM_CPU_X86_FAMILY
+	struct FCpuFeatures {
+		bool bSSE4 = false;
+		bool bAVX2 = false;
+	};
+
+	void CpuId(int Leaf, int SubLeaf, uint32 Regs[4]) {
+#if defined(_MSC_VER) && !defined(__clang__)
+		int Out[4];
+		__cpuidex(Out, Leaf, SubLeaf);
+		for (int I = 0; I < 4; ++I) {
+			Regs[I] = static_cast<uint32>(Out[I]);
+		}
+#else
+		__cpuid_count(Leaf, SubLeaf, Regs[0], Regs[1], Regs[2], Regs[3]);
+#endif
+	}
+
+	uint64 ReadXCR0() {
+#if defined(_MSC_VER) && !defined(__clang__)
+		return _xgetbv(0);
+#else
+		uint32 Lo, Hi;
+		__asm__ volatile("xgetbv" : "=a"(Lo), "=d"(Hi) : "c"(0));
+		return (static_cast<uint64>(Hi) << 32) | Lo;
+#endif
+	}
+
+	const FCpuFeatures& CpuFeatures() {
+		static const FCpuFeatures Features = []() {
+			FCpuFeatures Result;
+			uint32 Regs[4];
+			CpuId(0, 0, Regs);
+			const uint32 MaxLeaf = Regs[0];
+
+			CpuId(1, 0, Regs);
+			Result.bSSE4 = (Regs[2] & (1u << 19)) != 0;
+			const bool bOSXSave = (Regs[2] & (1u << 27)) != 0;
+			const bool bAVX = (Regs[2] & (1u << 28)) != 0;
+			// The OS has to save the YMM registers as well, otherwise AVX state is lost on context switches
+			if (MaxLeaf >= 7 && bOSXSave && bAVX && (ReadXCR0() & 0x6) == 0x6) {
+				CpuId(7, 0, Regs);
+				Result.bAVX2 = (Regs[1] & (1u << 5)) != 0;
+			}
+			return Result;
+		}();
+		return Features;
+	}
+
+	NOISE_TARGET_SSE4 FORCEINLINE __m128 SmoothCurveSSE4(__m128 X) {
+		const __m128 Inner = _mm_add_ps(_mm_mul_ps(X, _mm_sub_ps(_mm_mul_ps(X, _mm_set1_ps(6.0f)), _mm_set1_ps(15.0f))), _mm_set1_ps(10.0f));
+		return _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(X, X), X), Inner);
+	}
+
+	NOISE_TARGET_SSE4 FORCEINLINE __m128 LerpSSE4(__m128 A, __m128 B, __m128 T) {
+		return _mm_add_ps(A, _mm_mul_ps(T, _mm_sub_ps(B, A)));
+	}
+
+	NOISE_TARGET_SSE4 FORCEINLINE __m128 GradSSE4(__m128i Code, __m128 X, __m128 Y) {
+		const __m128i Mask = _mm_set1_epi32(3);
+		const __m128 One = _mm_set1_ps(1.0f);
+		const __m128 GX = _mm_sub_ps(_mm_cvtepi32_ps(_mm_and_si128(Code, Mask)), One);
+		const __m128 GY = _mm_sub_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(Code, 2), Mask)), One);
+		return _mm_add_ps(_mm_mul_ps(GX, X), _mm_mul_ps(GY, Y));
+	}
+
+	NOISE_TARGET_SSE4 FORCEINLINE __m128i LookupSSE4(const uint8* Codes, __m128i Index) {
+		alignas(16) int32 Lanes[4];
+		_mm_store_si128(reinterpret_cast<__m128i*>(Lanes), Index);
+		return _mm_setr_epi32(Codes[Lanes[0]], Codes[Lanes[1]], Codes[Lanes[2]], Codes[Lanes[3]]);
+	}
+
+	struct FPerlinRowSSE4 {
+		__m128i Row0;
+		__m128i Row1;
+		__m128 Y;
+		__m128 Ym1;
+		__m128 V;
+	};
+
+	NOISE_TARGET_SSE4 FORCEINLINE FPerlinRowSSE4 PreparePerlinRowSSE4(float SampleY) {
+		const float Yfl = FMath::FloorToFloat(SampleY);
+		return FPerlinRowSSE4{
+			_mm_set1_epi32(((int32)Yfl & 255) << 8),
+			_mm_set1_epi32((((int32)Yfl + 1) & 255) << 8),
+			_mm_set1_ps(SampleY - Yfl),
+			_mm_set1_ps((SampleY - Yfl) - 1.0f),
+			_mm_set1_ps(SmoothCurve(SampleY - Yfl))
+		};
+	}
+
+	// Perlin * 2 - 1 of four samples
+	NOISE_TARGET_SSE4 FORCEINLINE __m128 PerlinSSE4(const uint8* Codes, const FPerlinRowSSE4& Row, __m128 Location) {
+		const __m128i Mask = _mm_set1_epi32(255);
+		const __m128i OneI = _mm_set1_epi32(1);
+		const __m128 One = _mm_set1_ps(1.0f);
+		const __m128 Two = _mm_set1_ps(2.0f);
+
+		const __m128 Xfl = _mm_floor_ps(Location);
+		const __m128i XInt = _mm_cvttps_epi32(Xfl);
+		const __m128i Xi0 = _mm_and_si128(XInt, Mask);
+		const __m128i Xi1 = _mm_and_si128(_mm_add_epi32(XInt, OneI), Mask);
+		const __m128 X = _mm_sub_ps(Location, Xfl);
+		const __m128 Xm1 = _mm_sub_ps(X, One);
+		const __m128 U = SmoothCurveSSE4(X);
+
+		const __m128 G00 = GradSSE4(LookupSSE4(Codes, _mm_or_si128(Row.Row0, Xi0)), X, Row.Y);
+		const __m128 G10 = GradSSE4(LookupSSE4(Codes, _mm_or_si128(Row.Row0, Xi1)), Xm1, Row.Y);
+		const __m128 G01 = GradSSE4(LookupSSE4(Codes, _mm_or_si128(Row.Row1, Xi0)), X, Row.Ym1);
+		const __m128 G11 = GradSSE4(LookupSSE4(Codes, _mm_or_si128(Row.Row1, Xi1)), Xm1, Row.Ym1);
+
+		const __m128 Perlin = LerpSSE4(LerpSSE4(G00, G10, U), LerpSSE4(G01, G11, U), Row.V);
+		return _mm_sub_ps(_mm_mul_ps(Perlin, Two), One);
+	}
+
+	NOISE_TARGET_SSE4 void AccumulateRowSSE4(const uint8* Codes, const float* SampleX, float SampleY, float Amplitude, float* Heights, int Count) {
+		const FPerlinRowSSE4 Row = PreparePerlinRowSSE4(SampleY);
+		const __m128 Amp = _mm_set1_ps(Amplitude);
+
+		int I = 0;
+		for (; I + 4 <= Count; I += 4) {
+			const __m128 Noise = PerlinSSE4(Codes, Row, _mm_loadu_ps(SampleX + I));
+			_mm_storeu_ps(Heights + I, _mm_add_ps(_mm_loadu_ps(Heights + I), _mm_mul_ps(Noise, Amp)));
+		}
+		AccumulateRowScalar(SampleX + I, SampleY, Amplitude, Heights + I, Count - I);
+	}
+
+	// `AccumulateOctaves` four samples at a time. Spelled out per instruction set, the intrinsics can only be
+	// inlined into functions compiled for their target.
+	template<int Octave, int NumOctaves>
+	NOISE_TARGET_SSE4 FORCEINLINE __m128 AccumulateOctavesSSE4(__m128 Sum, const uint8* Codes, const FPerlinRowSSE4* Rows, const __m128* Amplitudes, const float* SampleXs, int XStride) {
+		Sum = _mm_add_ps(Sum, _mm_mul_ps(PerlinSSE4(Codes, Rows[Octave], _mm_loadu_ps(SampleXs + Octave * XStride)), Amplitudes[Octave]));
+		if constexpr (Octave + 1 < NumOctaves) {
+			return AccumulateOctavesSSE4<Octave + 1, NumOctaves>(Sum, Codes, Rows, Amplitudes, SampleXs, XStride);
+		}
+		else {
+			return Sum;
+		}
+	}
+
+	template<int NumOctaves>
+	NOISE_TARGET_SSE4 void SumRowPerlinSSE4(const FNoiseRowOctaves& Octaves, float* Heights, int Count) {
+		const uint8* Codes = GradientCodes();
+		FPerlinRowSSE4 Rows[NumOctaves];
+		__m128 Amplitudes[NumOctaves];
+		for (int O = 0; O < NumOctaves; ++O) {
+			Rows[O] = PreparePerlinRowSSE4(Octaves.SampleYs[O]);
+			Amplitudes[O] = _mm_set1_ps(Octaves.Amplitudes[O]);
+		}
+
+		int I = 0;
+		for (; I + 4 <= Count; I += 4) {
+			_mm_storeu_ps(Heights + I, AccumulateOctavesSSE4<0, NumOctaves>(_mm_setzero_ps(), Codes, Rows, Amplitudes, Octaves.SampleXs + I, Octaves.XStride));
+		}
+		FNoiseRowOctaves Tail = Octaves;
+		Tail.SampleXs += I;
+		SumRowUnrolled<FPerlinNoise, NumOctaves>(Tail, Heights + I, Count - I);
+	}
+
+	template<int... Counts>
+	FSumRowFunction SelectPerlinSSE4(int NumOctaves, std::integer_sequence<int, Counts...>) {
+		static constexpr FSumRowFunction Functions[] = { &SumRowPerlinSSE4<Counts + 1>... };
+		return Functions[NumOctaves - 1];
+	}
+
+	NOISE_TARGET_AVX2 FORCEINLINE __m256 SmoothCurveAVX2(__m256 X) {
+		const __m256 Inner = _mm256_add_ps(_mm256_mul_ps(X, _mm256_sub_ps(_mm256_mul_ps(X, _mm256_set1_ps(6.0f)), _mm256_set1_ps(15.0f))), _mm256_set1_ps(10.0f));
+		return _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(X, X), X), Inner);
+	}
+
+	NOISE_TARGET_AVX2 FORCEINLINE __m256 LerpAVX2(__m256 A, __m256 B, __m256 T) {
+		return _mm256_add_ps(A, _mm256_mul_ps(T, _mm256_sub_ps(B, A)));
+	}
+
+	NOISE_TARGET_AVX2 FORCEINLINE __m256 GradAVX2(const uint8* Codes, __m256i Index, __m256 X, __m256 Y) {
+		// Gathers 4 bytes starting at each code, only the low byte is ours
+		const __m256i Code = _mm256_and_si256(_mm256_i32gather_epi32(reinterpret_cast<const int*>(Codes), Index, 1), _mm256_set1_epi32(0xFF));
+		const __m256i Mask = _mm256_set1_epi32(3);
+		const __m256 One = _mm256_set1_ps(1.0f);
+		const __m256 GX = _mm256_sub_ps(_mm256_cvtepi32_ps(_mm256_and_si256(Code, Mask)), One);
+		const __m256 GY = _mm256_sub_ps(_mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(Code, 2), Mask)), One);
+		return _mm256_add_ps(_mm256_mul_ps(GX, X), _mm256_mul_ps(GY, Y));
+	}
+
+	struct FPerlinRowAVX2 {
+		__m256i Row0;
+		__m256i Row1;
+		__m256 Y;
+		__m256 Ym1;
+		__m256 V;
+	};
+
+	NOISE_TARGET_AVX2 FORCEINLINE FPerlinRowAVX2 PreparePerlinRowAVX2(float SampleY) {
+		const float Yfl = FMath::FloorToFloat(SampleY);
+		return FPerlinRowAVX2{
+			_mm256_set1_epi32(((int32)Yfl & 255) << 8),
+			_mm256_set1_epi32((((int32)Yfl + 1) & 255) << 8),
+			_mm256_set1_ps(SampleY - Yfl),
+			_mm256_set1_ps((SampleY - Yfl) - 1.0f),
+			_mm256_set1_ps(SmoothCurve(SampleY - Yfl))
+		};
+	}
+
+	// Perlin * 2 - 1 of eight samples
+	NOISE_TARGET_AVX2 FORCEINLINE __m256 PerlinAVX2(const uint8* Codes, const FPerlinRowAVX2& Row, __m256 Location) {
+		const __m256i Mask = _mm256_set1_epi32(255);
+		const __m256i OneI = _mm256_set1_epi32(1);
+		const __m256 One = _mm256_set1_ps(1.0f);
+		const __m256 Two = _mm256_set1_ps(2.0f);
+
+		const __m256 Xfl = _mm256_floor_ps(Location);
+		const __m256i XInt = _mm256_cvttps_epi32(Xfl);
+		const __m256i Xi0 = _mm256_and_si256(XInt, Mask);
+		const __m256i Xi1 = _mm256_and_si256(_mm256_add_epi32(XInt, OneI), Mask);
+		const __m256 X = _mm256_sub_ps(Location, Xfl);
+		const __m256 Xm1 = _mm256_sub_ps(X, One);
+		const __m256 U = SmoothCurveAVX2(X);
+
+		const __m256 G00 = GradAVX2(Codes, _mm256_or_si256(Row.Row0, Xi0), X, Row.Y);
+		const __m256 G10 = GradAVX2(Codes, _mm256_or_si256(Row.Row0, Xi1), Xm1, Row.Y);
+		const __m256 G01 = GradAVX2(Codes, _mm256_or_si256(Row.Row1, Xi0), X, Row.Ym1);
+		const __m256 G11 = GradAVX2(Codes, _mm256_or_si256(Row.Row1, Xi1), Xm1, Row.Ym1);
+
+		const __m256 Perlin = LerpAVX2(LerpAVX2(G00, G10, U), LerpAVX2(G01, G11, U), Row.V);
+		return _mm256_sub_ps(_mm256_mul_ps(Perlin, Two), One);
+	}
+
+	NOISE_TARGET_AVX2 void AccumulateRowAVX2(const uint8* Codes, const float* SampleX, float SampleY, float Amplitude, float* Heights, int Count) {
+		const FPerlinRowAVX2 Row = PreparePerlinRowAVX2(SampleY);
+		const __m256 Amp = _mm256_set1_ps(Amplitude);
+
+		int I = 0;
+		for (; I + 8 <= Count; I += 8) {
+			const __m256 Noise = PerlinAVX2(Codes, Row, _mm256_loadu_ps(SampleX + I));
+			_mm256_storeu_ps(Heights + I, _mm256_add_ps(_mm256_loadu_ps(Heights + I), _mm256_mul_ps(Noise, Amp)));
+		}
+		AccumulateRowScalar(SampleX + I, SampleY, Amplitude, Heights + I, Count - I);
+	}
+
+	template<int Octave, int NumOctaves>
+	NOISE_TARGET_AVX2 FORCEINLINE __m256 AccumulateOctavesAVX2(__m256 Sum, const uint8* Codes, const FPerlinRowAVX2* Rows, const __m256* Amplitudes, const float* SampleXs, int XStride) {
+		Sum = _mm256_add_ps(Sum, _mm256_mul_ps(PerlinAVX2(Codes, Rows[Octave], _mm256_loadu_ps(SampleXs + Octave * XStride)), Amplitudes[Octave]));
+		if constexpr (Octave + 1 < NumOctaves) {
+			return AccumulateOctavesAVX2<Octave + 1, NumOctaves>(Sum, Codes, Rows, Amplitudes, SampleXs, XStride);
+		}
+		else {
+			return Sum;
+		}
+	}
+
+	template<int NumOctaves>
+	NOISE_TARGET_AVX2 void SumRowPerlinAVX2(const FNoiseRowOctaves& Octaves, float* Heights, int Count) {
+		const uint8* Codes = GradientCodes();
+		FPerlinRowAVX2 Rows[NumOctaves];
+		__m256 Amplitudes[NumOctaves];
+		for (int O = 0; O < NumOctaves; ++O) {
+			Rows[O] = PreparePerlinRowAVX2(Octaves.SampleYs[O]);
+			Amplitudes[O] = _mm256_set1_ps(Octaves.Amplitudes[O]);
+		}
+
+		int I = 0;
+		for (; I + 8 <= Count; I += 8) {
+			_mm256_storeu_ps(Heights + I, AccumulateOctavesAVX2<0, NumOctaves>(_mm256_setzero_ps(), Codes, Rows, Amplitudes, Octaves.SampleXs + I, Octaves.XStride));
+		}
+		FNoiseRowOctaves Tail = Octaves;
+		Tail.SampleXs += I;
+		SumRowUnrolled<FPerlinNoise, NumOctaves>(Tail, Heights + I, Count - I);
+	}
+
+	template<int... Counts>
+	FSumRowFunction SelectPerlinAVX2(int NumOctaves, std::integer_sequence<int, Counts...>) {
+		static constexpr FSumRowFunction Functions[] = { &SumRowPerlinAVX2<Counts + 1>... };
+		return Functions[NumOctaves - 1];
+	}
+#endif
+}
+
+namespace NoiseKernel {
+	bool IsSupported(ENoiseKernel Kernel) {
+		switch (Kernel) {
+			case ENoiseKernel::Reference:
+			case ENoiseKernel::Scalar:
+				return true;
+#if PLATFORM_CPU_X86_FAMILY
+			case ENoiseKernel::SSE4:
+				return CpuFeatures().bSSE4;
+			case ENoiseKernel::AVX2:
+				return CpuFeatures().bAVX2;
+#endif
+			default:
+				return false;
+		}
+	}
+
+	ENoiseKernel BestSupported() {
+		static const ENoiseKernel Best = []() {
+			if (IsSupported(ENoiseKernel::AVX2)) return ENoiseKernel::AVX2;
+			if (IsSupported(ENoiseKernel::SSE4)) return ENoiseKernel::SSE4;
+			return ENoiseKernel::Scalar;
+		}();
+		return Best;
+	}
+
+	const TCHAR* ToString(ENoiseKernel Kernel) {
+		switch (Kernel) {
+			case ENoiseKernel::Reference: return TEXT("Reference");
+			case ENoiseKernel::Scalar: return TEXT("Scalar");
+			case ENoiseKernel::SSE4: return TEXT("SSE4");
+			case ENoiseKernel::AVX2: return TEXT("AVX2");
+			default: return TEXT("Unknown");
+		}
+	}
+
+	void AccumulateOctaveRow(ENoiseKernel Kernel, const float* SampleX, float SampleY, float Amplitude, float* Heights, int Count) {
+		check(IsSupported(Kernel));
+		switch (Kernel) {
+			case ENoiseKernel::Reference: {
+				AccumulateRowReference(SampleX, SampleY, Amplitude, Heights, Count);
+				break;
+			}
+#if PLATFORM_CPU_X86_FAMILY
+			case ENoiseKernel::SSE4: {
+				AccumulateRowSSE4(GradientCodes(), SampleX, SampleY, Amplitude, Heights, Count);
+				break;
+			}
+			case ENoiseKernel::AVX2: {
+				AccumulateRowAVX2(GradientCodes(), SampleX, SampleY, Amplitude, Heights, Count);
+				break;
+			}
+#endif
+			default: {
+				AccumulateRowScalar(SampleX, SampleY, Amplitude, Heights, Count);
+				break;
+			}
+		}
+	}
+
+	const TCHAR* ToString(ENoiseBackend Backend) {
+		switch (Backend) {
+			case ENoiseBackend::Perlin: return TEXT("Perlin");
+			case ENoiseBackend::OpenSimplex2: return TEXT("OpenSimplex2");
+			case ENoiseBackend::Value: return TEXT("Value");
+			default: return TEXT("Unknown");
+		}
+	}
+
+	void SumOctaveRow(ENoiseBackend Backend, ENoiseKernel Kernel, const FNoiseRowOctaves& Octaves, float* Heights, int Count) {
+		check(IsSupported(Kernel));
+		const int NumOctaves = Octaves.NumOctaves;
+		if (NumOctaves == 0) {
+			FMemory::Memzero(Heights, Count * sizeof(float));
+			return;
+		}
+		const bool bUnrolled = Kernel != ENoiseKernel::Reference && NumOctaves <= MaxUnrolledOctaves;
+		const auto Unrolled = std::make_integer_sequence<int, MaxUnrolledOctaves>();
+
+		switch (Backend) {
+			case ENoiseBackend::OpenSimplex2: {
+				(bUnrolled ? SelectUnrolled<FOpenSimplex2Noise>(NumOctaves, Unrolled) : &SumRowGeneric<FOpenSimplex2Noise>)(Octaves, Heights, Count);
+				break;
+			}
+			case ENoiseBackend::Value: {
+				(bUnrolled ? SelectUnrolled<FValueNoise>(NumOctaves, Unrolled) : &SumRowGeneric<FValueNoise>)(Octaves, Heights, Count);
+				break;
+			}
+			default: {
+				if (!bUnrolled) {
+					FMemory::Memzero(Heights, Count * sizeof(float));
+					for (int O = 0; O < NumOctaves; ++O) {
+						AccumulateOctaveRow(Kernel, Octaves.SampleXs + O * Octaves.XStride, Octaves.SampleYs[O], Octaves.Amplitudes[O], Heights, Count);
+					}
+					break;
+				}
+				switch (Kernel) {
+#if PLATFORM_CPU_X86_FAMILY
+					case ENoiseKernel::SSE4: {
+						SelectPerlinSSE4(NumOctaves, Unrolled)(Octaves, Heights, Count);
+						break;
+					}
+					case ENoiseKernel::AVX2: {
+						SelectPerlinAVX2(NumOctaves, Unrolled)(Octaves, Heights, Count);
+						break;
+					}
+#endif
+					default: {
+						SelectUnrolled<FPerlinNoise>(NumOctaves, Unrolled)(Octaves, Heights, Count);
+						break;
+					}
+				}
+				break;
+			}
+		}
+	}
+
+	void SumOctavePoints(ENoiseBackend Backend, const FNoisePointOctaves& Octaves, float* Heights, int Count) {
+		switch (Backend) {
+			case ENoiseBackend::OpenSimplex2: {
+				SumPoints<FOpenSimplex2Noise>(Octaves, Heights, Count);
+				break;
+			}
+			case ENoiseBackend::Value: {
+				SumPoints<FValueNoise>(Octaves, Heights, Count);
+				break;
+			}
+			default: {
+				SumPoints<FPerlinNoise>(Octaves, Heights, Count);
+				break;
+			}
+		}
+	}
+}
@@ -0,0 +1,189 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "NoiseMap.h"
+#include "NoiseKernel.h"
+#include "NoiseGraph.h"
+#include "Math/UnrealMathUtility.h"
+#include "Async/ParallelFor.h"
+
+void FNoiseOctaves::Init(int Seed, int InWidth, int InHeight, float InScale, int Octaves, float Persistance, float Lacunarity, FVector2D NoiseOffset, ENoiseBackend InBackend, float InSampleSpacing) {
+	FRandomStream RandomStream(Seed);
+
+	Width = InWidth;
+	Height = InHeight;
+	NumOctaves = Octaves;
+	Backend = InBackend;
+	Scale = InScale;
+	SampleSpacing = InSampleSpacing;
+
+	MaxPossibleHeight = 0.;
+	float Amplitude = 1.;
+	float Frequency = 1.;
+	TArray<FVector2D> OctaveOffsets;
+	OctaveOffsets.SetNum(Octaves);
+	for (int I = 0; I < Octaves; ++I) {
+		const float X = RandomStream.FRandRange(-100000, 100000);
+		const float Y = RandomStream.FRandRange(-100000, 100000);
+		OctaveOffsets[I] = FVector2D(X, Y);
+
+		MaxPossibleHeight += Amplitude;
+		Amplitude *= Persistance;
+	}
+
+	// Sample coordinates only depend on X or Y (and the octave), so they are computed once per column/row
+	// with the same double precision math the per-sample loop used, and then streamed through the kernel.
+	SampleXs.SetNumUninitialized(Octaves * Width);
+	SampleYs.SetNumUninitialized(Octaves * Height);
+	Amplitudes.SetNumUninitialized(Octaves);
+	Origins.SetNumUninitialized(Octaves);
+	Frequencies.SetNumUninitialized(Octaves);
+
+	Amplitude = 1.;
+	Frequency = 1.;
+	for (int I = 0; I < Octaves; ++I) {
+		Origins[I] = OctaveOffsets[I] + NoiseOffset;
+		Frequencies[I] = Frequency;
+		for (int X = 0; X < Width; ++X) {
+			SampleXs[I * Width + X] = (X * SampleSpacing + OctaveOffsets[I].X + NoiseOffset.X) / Scale * Frequency;
+		}
+		for (int Y = 0; Y < Height; ++Y) {
+			SampleYs[Y * Octaves + I] = (Y * SampleSpacing + OctaveOffsets[I].Y + NoiseOffset.Y) / Scale * Frequency;
+		}
+		Amplitudes[I] = Amplitude;
+
+		Amplitude *= Persistance;
+		Frequency *= Lacunarity;
+	}
+}
+
+void FNoiseOctaves::SumRow(ENoiseKernel Kernel, int Y, float* OutRow) const {
+	const FNoiseRowOctaves Octaves{ SampleXs.GetData(), Width, SampleYs.GetData() + Y * NumOctaves, Amplitudes.GetData(), NumOctaves };
+	NoiseKernel::SumOctaveRow(Backend, Kernel, Octaves, OutRow, Width);
+}
+
+void FNoiseOctaves::SumColumns(ENoiseKernel Kernel, int Y, TArrayView<const int> Columns, float* Out) const {
+	const int NumColumns = Columns.Num();
+	TArray<float, TInlineAllocator<64>> Xs;
+	Xs.SetNumUninitialized(NumOctaves * NumColumns);
+	for (int I = 0; I < NumOctaves; ++I) {
+		for (int C = 0; C < NumColumns; ++C) {
+			Xs[I * NumColumns + C] = SampleXs[I * Width + Columns[C]];
+		}
+	}
+	const FNoiseRowOctaves Octaves{ Xs.GetData(), NumColumns, SampleYs.GetData() + Y * NumOctaves, Amplitudes.GetData(), NumOctaves };
+	NoiseKernel::SumOctaveRow(Backend, Kernel, Octaves, Out, NumColumns);
+}
+
+void FNoiseOctaves::SumPoints(const float* Xs, const float* Ys, int Count, float* Out) const {
+	TArray<float, TInlineAllocator<1024>> OctaveXs;
+	OctaveXs.SetNumUninitialized(NumOctaves * Count);
+	TArray<float, TInlineAllocator<1024>> OctaveYs;
+	OctaveYs.SetNumUninitialized(NumOctaves * Count);
+	for (int I = 0; I < NumOctaves; ++I) {
+		for (int P = 0; P < Count; ++P) {
+			OctaveXs[I * Count + P] = (Xs[P] * SampleSpacing + Origins[I].X) / Scale * Frequencies[I];
+			OctaveYs[I * Count + P] = (Ys[P] * SampleSpacing + Origins[I].Y) / Scale * Frequencies[I];
+		}
+	}
+	const FNoisePointOctaves Octaves{ OctaveXs.GetData(), OctaveYs.GetData(), Count, Amplitudes.GetData(), NumOctaves };
+	NoiseKernel::SumOctavePoints(Backend, Octaves, Out, Count);
+}
+
+FFloatInterval FNoiseOctaves::GlobalBounds() const {
+	// TODO: Re-think this later
+	const float BoundaryThreshold = 0.5;
+	return FFloatInterval(-MaxPossibleHeight * BoundaryThreshold, MaxPossibleHeight * BoundaryThreshold);
+}
+
+NoiseMap::NoiseMap() {
+}
+
+template<typename NoiseSourceType>
+void NoiseMap::Fill(ENormalizeMode NormalizeMode, const NoiseSourceType& NoiseOctaves, ENoiseThreading Threading) {
+	const ENoiseKernel Kernel = NoiseKernel::BestSupported();
+
+	// Bands have a fixed number of rows, so the work split (and the merge order of the per band bounds)
+	// does not depend on how many workers end up running them.
+	const int NumBands = FMath::DivideAndRoundUp(Height, RowsPerBand);
+	TArray<float> BandMinNoise;
+	BandMinNoise.SetNumUninitialized(NumBands);
+	TArray<float> BandMaxNoise;
+	BandMaxNoise.SetNumUninitialized(NumBands);
+
+	const EParallelForFlags ParallelFlags = Threading == ENoiseThreading::Parallel ? EParallelForFlags::None : EParallelForFlags::ForceSingleThread;
+	ParallelFor(NumBands, [&](int Band) {
+		float BandMax = TNumericLimits<float>::Lowest();
+		float BandMin = TNumericLimits<float>::Max();
+		const int EndY = std::min(Height, (Band + 1) * RowsPerBand);
+		for (int Y = Band * RowsPerBand; Y < EndY; ++Y) {
+			float* Row = &NoiseValues[Y * Width];
+			NoiseOctaves.SumRow(Kernel, Y, Row);
+
+			for (int X = 0; X < Width; ++X) {
+				BandMax = std::max(BandMax, Row[X]);
+				BandMin = std::min(BandMin, Row[X]);
+			}
+		}
+		BandMaxNoise[Band] = BandMax;
+		BandMinNoise[Band] = BandMin;
+	}, ParallelFlags);
+
+	MaxNoise = TNumericLimits<float>::Lowest();
+	MinNoise = TNumericLimits<float>::Max();
+	for (int Band = 0; Band < NumBands; ++Band) {
+		MaxNoise = std::max(MaxNoise, BandMaxNoise[Band]);
+		MinNoise = std::min(MinNoise, BandMinNoise[Band]);
+	}
+
+	const FFloatInterval GlobalBounds = NoiseOctaves.GlobalBounds();
+	const float NormalizeMin = NormalizeMode == ENormalizeMode::Local ? MinNoise : GlobalBounds.Min;
+	const float NormalizeMax = NormalizeMode == ENormalizeMode::Local ? MaxNoise : GlobalBounds.Max;
+	ParallelFor(NumBands, [&](int Band) {
+		const int EndIndex = std::min(Height, (Band + 1) * RowsPerBand) * Width;
+		for (int NoiseIndex = Band * RowsPerBand * Width; NoiseIndex < EndIndex; ++NoiseIndex) {
+			NoiseValues[NoiseIndex] = InverseLerp(NormalizeMin, NormalizeMax, NoiseValues[NoiseIndex]);
+		}
+	}, ParallelFlags);
+}
+
+void NoiseMap::Init(ENormalizeMode NormalizeMode, int Seed, int W, int H, float Scale, int Octaves, float Persistance, float Lacunarity, FVector2D NoiseOffset, ENoiseThreading Threading, ENoiseBackend Backend, float SampleSpacing)
+{
+	RandomStream = FRandomStream(Seed);
+
+	Width = W;
+	Height = H;
+	NoiseValues.SetNum(Width * Height);
+
+	FNoiseOctaves NoiseOctaves;
+	NoiseOctaves.Init(Seed, Width, Height, Scale, Octaves, Persistance, Lacunarity, NoiseOffset, Backend, SampleSpacing);
+	Fill(NormalizeMode, NoiseOctaves, Threading);
+}
+
+void NoiseMap::Init(ENormalizeMode NormalizeMode, const FNoiseGraph& Graph, int Seed, int W, int H, float Scale, FVector2D NoiseOffset, ENoiseThreading Threading, float SampleSpacing) {
+	RandomStream = FRandomStream(Seed);
+
+	Width = W;
+	Height = H;
+	NoiseValues.SetNum(Width * Height);
+
+	FNoiseGraphSampler Sampler;
+	Sampler.Init(Graph, Seed, Width, Height, Scale, NoiseOffset, SampleSpacing);
+	Fill(NormalizeMode, Sampler, Threading);
+}
+
+FFloatInterval NoiseMap::NormalizedRange(ENormalizeMode NormalizeMode) {
+	switch (NormalizeMode) {
+		case ENormalizeMode::Global: {
+			// Raw heights are within [-MaxPossibleHeight, MaxPossibleHeight], normalized against half of that
+			return FFloatInterval(-0.5, 1.5);
+		}
+		default: {
+			return FFloatInterval(0., 1.);
+		}
+	}
+}
+
+NoiseMap::~NoiseMap()
+{
+}
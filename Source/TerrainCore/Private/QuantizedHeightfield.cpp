@@ -0,0 +1,72 @@
+#include "QuantizedHeightfield.h"
+#include "TerrainMeshing.h"
+
+void FQuantizedHeightfield::Quantize(TArrayView<const float> Heights, int InWidth, int InHeight, FFloatInterval Range) {
+	check(Heights.Num() == InWidth * InHeight);
+	Allocate(InWidth, InHeight, Range);
+	QuantizeRange(0, Heights);
+}
+
+void FQuantizedHeightfield::Allocate(int InWidth, int InHeight, FFloatInterval Range) {
+	check(Range.Max > Range.Min);
+
+	Width = InWidth;
+	Height = InHeight;
+	MinHeight = Range.Min;
+	MaxHeight = Range.Max;
+	Samples.SetNumUninitialized(Width * Height);
+}
+
+void FQuantizedHeightfield::QuantizeRange(int FirstSample, TArrayView<const float> Heights) {
+	check(FirstSample >= 0 && FirstSample + Heights.Num() <= Samples.Num());
+
+	const float ToSample = MAX_uint16 / (MaxHeight - MinHeight);
+	uint16* Out = Samples.GetData() + FirstSample;
+	for (int I = 0; I < Heights.Num(); ++I) {
+		const float Clamped = FMath::Clamp(Heights[I], MinHeight, MaxHeight);
+		Out[I] = static_cast<uint16>(FMath::RoundToInt((Clamped - MinHeight) * ToSample));
+	}
+}
+
+uint16 FQuantizedHeightfield::QuantizeSample(float Height) const {
+	const float ToSample = MAX_uint16 / (MaxHeight - MinHeight);
+	const float Clamped = FMath::Clamp(Height, MinHeight, MaxHeight);
+	return static_cast<uint16>(FMath::RoundToInt((Clamped - MinHeight) * ToSample));
+}
+
+void FQuantizedHeightfield::Dequantize(TArray<float>& OutHeights) const {
+	const float Step = GetStep();
+	OutHeights.SetNumUninitialized(Samples.Num());
+	for (int I = 0; I < Samples.Num(); ++I) {
+		OutHeights[I] = MinHeight + Samples[I] * Step;
+	}
+}
+
+void FQuantizedApron::Quantize(const FHeightApron& Apron, const FQuantizedHeightfield& HeightField) {
+	check(Apron.Top.Num() == HeightField.Width + 2 && Apron.Bottom.Num() == HeightField.Width + 2);
+	check(Apron.Left.Num() == HeightField.Height && Apron.Right.Num() == HeightField.Height);
+
+	Samples.Reset(NumSamples(HeightField.Width, HeightField.Height));
+	for (const TArray<float>* Side : { &Apron.Top, &Apron.Bottom, &Apron.Left, &Apron.Right }) {
+		for (const float Height : *Side) {
+			Samples.Add(HeightField.QuantizeSample(Height));
+		}
+	}
+}
+
+void FQuantizedApron::Dequantize(const FQuantizedHeightfield& HeightField, FHeightApron& OutApron) const {
+	check(Samples.Num() == NumSamples(HeightField.Width, HeightField.Height));
+
+	const float Step = HeightField.GetStep();
+	const uint16* In = Samples.GetData();
+	auto Side = [&](TArray<float>& Out, int Count) {
+		Out.SetNumUninitialized(Count);
+		for (int I = 0; I < Count; ++I) {
+			Out[I] = HeightField.MinHeight + *In++ * Step;
+		}
+	};
+	Side(OutApron.Top, HeightField.Width + 2);
+	Side(OutApron.Bottom, HeightField.Width + 2);
+	Side(OutApron.Left, HeightField.Height);
+	Side(OutApron.Right, HeightField.Height);
+}
@@ -0,0 +1,281 @@
+#include "TerrainBakedWorld.h"
+#include "Async/MappedFileHandle.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/Crc.h"
+#include "Misc/Paths.h"
+
+namespace {
+	constexpr uint32 WorldMagic = 0x574B4254; // "TBKW"
+	constexpr int MaxLods = 16;
+
+	struct FWorldHeader {
+		uint32 Magic;
+		uint32 Version;
+		uint64 IndexOffset;
+		uint64 ParamsHash;
+		uint64 ClassifierHash;
+		uint64 ElevationHash;
+		int32 MinX;
+		int32 MinY;
+		int32 MaxX;
+		int32 MaxY;
+		int32 ChunkSamples;
+		int32 NumLods;
+	};
+	static_assert(sizeof(FWorldHeader) == 64, "World header layout is part of the file format");
+
+	struct FIndexRecord {
+		uint64 Offset;
+		uint32 Size;
+		uint32 Crc;
+	};
+	static_assert(sizeof(FIndexRecord) == 16, "Index layout is part of the file format");
+
+	int64 HeaderSize(int NumLods) {
+		return sizeof(FWorldHeader) + NumLods * sizeof(int32);
+	}
+
+	int VerticesPerSide(int ChunkSamples, int LodStep) {
+		return (ChunkSamples - 1) / LodStep + 1;
+	}
+
+	int64 ApronOffset(const FBakedWorldDesc& Desc) {
+		return 2 * sizeof(float) + static_cast<int64>(Desc.ChunkSamples) * Desc.ChunkSamples * sizeof(uint16);
+	}
+
+	int64 ClassesOffset(const FBakedWorldDesc& Desc) {
+		return ApronOffset(Desc) + FQuantizedApron::NumSamples(Desc.ChunkSamples, Desc.ChunkSamples) * sizeof(uint16);
+	}
+
+	int64 LodOffset(const FBakedWorldDesc& Desc, int LodIndex) {
+		int64 Offset = ClassesOffset(Desc);
+		if (Desc.HasClasses()) {
+			Offset += static_cast<int64>(Desc.ChunkSamples) * Desc.ChunkSamples;
+		}
+		for (int I = 0; I < LodIndex; ++I) {
+			Offset += FMath::Square(static_cast<int64>(VerticesPerSide(Desc.ChunkSamples, Desc.LodSteps[I]))) * sizeof(float);
+		}
+		return Offset;
+	}
+
+	int ChunkIndex(const FBakedWorldDesc& Desc, FIntPoint ChunkCoord) {
+		const FIntPoint Local = ChunkCoord - Desc.ChunkRect.Min;
+		return Local.Y * Desc.ChunkRect.Width() + Local.X;
+	}
+
+	FWorldHeader MakeHeader(const FBakedWorldDesc& Desc, uint64 IndexOffset) {
+		FWorldHeader Header;
+		Header.Magic = WorldMagic;
+		Header.Version = TerrainBakedWorld::Version;
+		Header.IndexOffset = IndexOffset;
+		Header.ParamsHash = Desc.ParamsHash;
+		Header.ClassifierHash = Desc.ClassifierHash;
+		Header.ElevationHash = Desc.ElevationHash;
+		Header.MinX = Desc.ChunkRect.Min.X;
+		Header.MinY = Desc.ChunkRect.Min.Y;
+		Header.MaxX = Desc.ChunkRect.Max.X;
+		Header.MaxY = Desc.ChunkRect.Max.Y;
+		Header.ChunkSamples = Desc.ChunkSamples;
+		Header.NumLods = Desc.LodSteps.Num();
+		return Header;
+	}
+}
+
+namespace TerrainBakedWorld {
+	int64 RecordSize(const FBakedWorldDesc& Desc) {
+		return LodOffset(Desc, Desc.LodSteps.Num());
+	}
+}
+
+FBakedWorldWriter::FBakedWorldWriter(const FString& Path, const FBakedWorldDesc& InDesc)
+	: Desc(InDesc)
+{
+	check(Desc.NumChunks() > 0 && Desc.ChunkSamples > 1 && Desc.LodSteps.Num() <= MaxLods);
+	for (const int LodStep : Desc.LodSteps) {
+		check(LodStep > 0 && (Desc.ChunkSamples - 1) % LodStep == 0);
+	}
+
+	IFileManager::Get().MakeDirectory(*FPaths::GetPath(Path), true);
+	File.Reset(FPlatformFileManager::Get().GetPlatformFile().OpenWrite(*Path));
+	if (!File) {
+		return;
+	}
+
+	// Rewritten by `Finish` once the index offset is known, a file that was never finished has none
+	const FWorldHeader Header = MakeHeader(Desc, 0);
+	File->Write(reinterpret_cast<const uint8*>(&Header), sizeof(Header));
+	File->Write(reinterpret_cast<const uint8*>(Desc.LodSteps.GetData()), Desc.LodSteps.Num() * sizeof(int32));
+	Index.SetNum(Desc.NumChunks());
+}
+
+FBakedWorldWriter::~FBakedWorldWriter() {
+}
+
+bool FBakedWorldWriter::Add(FIntPoint ChunkCoord, const FBakedChunk& Chunk) {
+	check(Desc.ChunkRect.Contains(ChunkCoord));
+	check(Chunk.HeightField.Width == Desc.ChunkSamples && Chunk.HeightField.Height == Desc.ChunkSamples);
+	check(Chunk.Apron.Samples.Num() == FQuantizedApron::NumSamples(Desc.ChunkSamples, Desc.ChunkSamples));
+	check(!Desc.HasClasses() || Chunk.Classes.Num() == Desc.ChunkSamples * Desc.ChunkSamples);
+	check(Chunk.LodElevations.Num() == Desc.LodSteps.Num());
+	if (!File) {
+		return false;
+	}
+
+	Scratch.SetNumUninitialized(TerrainBakedWorld::RecordSize(Desc));
+	uint8* Out = Scratch.GetData();
+	FMemory::Memcpy(Out, &Chunk.HeightField.MinHeight, sizeof(float));
+	FMemory::Memcpy(Out + sizeof(float), &Chunk.HeightField.MaxHeight, sizeof(float));
+	FMemory::Memcpy(Out + 2 * sizeof(float), Chunk.HeightField.Samples.GetData(), Chunk.HeightField.Samples.Num() * sizeof(uint16));
+	FMemory::Memcpy(Out + ApronOffset(Desc), Chunk.Apron.Samples.GetData(), Chunk.Apron.Samples.Num() * sizeof(uint16));
+	if (Desc.HasClasses()) {
+		FMemory::Memcpy(Out + ClassesOffset(Desc), Chunk.Classes.GetData(), Chunk.Classes.Num());
+	}
+	for (int LodIndex = 0; LodIndex < Desc.LodSteps.Num(); ++LodIndex) {
+		const TArray<float>& Elevations = Chunk.LodElevations[LodIndex];
+		check(Elevations.Num() == FMath::Square(VerticesPerSide(Desc.ChunkSamples, Desc.LodSteps[LodIndex])));
+		FMemory::Memcpy(Out + LodOffset(Desc, LodIndex), Elevations.GetData(), Elevations.Num() * sizeof(float));
+	}
+
+	FIndexEntry& Entry = Index[ChunkIndex(Desc, ChunkCoord)];
+	Entry.Offset = File->Tell();
+	Entry.Size = Scratch.Num();
+	Entry.Crc = FCrc::MemCrc32(Scratch.GetData(), Scratch.Num());
+	return File->Write(Scratch.GetData(), Scratch.Num());
+}
+
+bool FBakedWorldWriter::Finish() {
+	if (!File) {
+		return false;
+	}
+
+	const uint64 IndexOffset = File->Tell();
+	for (const FIndexEntry& Entry : Index) {
+		const FIndexRecord Record{ Entry.Offset, Entry.Size, Entry.Crc };
+		if (!File->Write(reinterpret_cast<const uint8*>(&Record), sizeof(Record))) {
+			return false;
+		}
+	}
+
+	const FWorldHeader Header = MakeHeader(Desc, IndexOffset);
+	const bool bWritten = File->Seek(0)
+		&& File->Write(reinterpret_cast<const uint8*>(&Header), sizeof(Header))
+		&& File->Flush();
+	File.Reset();
+	return bWritten;
+}
+
+FBakedWorldReader::FBakedWorldReader() {
+}
+
+FBakedWorldReader::~FBakedWorldReader() {
+	Region.Reset();
+	Handle.Reset();
+}
+
+bool FBakedWorldReader::Open(const FString& Path) {
+	Handle.Reset(FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*Path));
+	if (!Handle) {
+		return false;
+	}
+	DataSize = Handle->GetFileSize();
+	if (DataSize < static_cast<int64>(sizeof(FWorldHeader))) {
+		return false;
+	}
+	Region.Reset(Handle->MapRegion(0, DataSize));
+	if (!Region) {
+		return false;
+	}
+	Data = Region->GetMappedPtr();
+
+	FWorldHeader Header;
+	FMemory::Memcpy(&Header, Data, sizeof(Header));
+	if (Header.Magic != WorldMagic ||
+		Header.Version != TerrainBakedWorld::Version ||
+		Header.IndexOffset == 0 ||
+		Header.NumLods < 0 || Header.NumLods > MaxLods ||
+		Header.ChunkSamples < 2 ||
+		Header.MaxX <= Header.MinX || Header.MaxY <= Header.MinY ||
+		DataSize < HeaderSize(Header.NumLods)) {
+		return false;
+	}
+
+	Desc.ParamsHash = Header.ParamsHash;
+	Desc.ClassifierHash = Header.ClassifierHash;
+	Desc.ElevationHash = Header.ElevationHash;
+	Desc.ChunkRect = FIntRect(Header.MinX, Header.MinY, Header.MaxX, Header.MaxY);
+	Desc.ChunkSamples = Header.ChunkSamples;
+	Desc.LodSteps.SetNumUninitialized(Header.NumLods);
+	FMemory::Memcpy(Desc.LodSteps.GetData(), Data + sizeof(FWorldHeader), Header.NumLods * sizeof(int32));
+	for (const int LodStep : Desc.LodSteps) {
+		if (LodStep <= 0 || (Desc.ChunkSamples - 1) % LodStep != 0) {
+			return false;
+		}
+	}
+
+	IndexOffset = Header.IndexOffset;
+	RecordStates = MakeUnique<std::atomic<ERecordState>[]>(Desc.NumChunks());
+	return IndexOffset + Desc.NumChunks() * static_cast<int64>(sizeof(FIndexRecord)) <= DataSize;
+}
+
+const uint8* FBakedWorldReader::FindRecord(FIntPoint ChunkCoord) const {
+	if (!Data || !Contains(ChunkCoord)) {
+		return nullptr;
+	}
+
+	const int Index = ChunkIndex(Desc, ChunkCoord);
+	FIndexRecord Record;
+	FMemory::Memcpy(&Record, Data + IndexOffset + Index * sizeof(FIndexRecord), sizeof(Record));
+	if (Record.Size != TerrainBakedWorld::RecordSize(Desc) ||
+		Record.Offset < static_cast<uint64>(HeaderSize(Desc.LodSteps.Num())) ||
+		Record.Offset + Record.Size > static_cast<uint64>(IndexOffset)) {
+		return nullptr;
+	}
+
+	const uint8* RecordData = Data + Record.Offset;
+	// The file is mapped read only, so a record checked once stays valid. Workers racing on the first lookup
+	// both compute the same answer.
+	ERecordState State = RecordStates[Index].load(std::memory_order_relaxed);
+	if (State == ERecordState::Unchecked) {
+		State = FCrc::MemCrc32(RecordData, Record.Size) == Record.Crc ? ERecordState::Valid : ERecordState::Corrupt;
+		RecordStates[Index].store(State, std::memory_order_relaxed);
+	}
+	return State == ERecordState::Valid ? RecordData : nullptr;
+}
+
+bool FBakedWorldReader::ReadHeightField(FIntPoint ChunkCoord, FQuantizedHeightfield& OutHeightField, FQuantizedApron& OutApron) const {
+	const uint8* RecordData = FindRecord(ChunkCoord);
+	if (!RecordData) {
+		return false;
+	}
+	OutHeightField.Width = Desc.ChunkSamples;
+	OutHeightField.Height = Desc.ChunkSamples;
+	FMemory::Memcpy(&OutHeightField.MinHeight, RecordData, sizeof(float));
+	FMemory::Memcpy(&OutHeightField.MaxHeight, RecordData + sizeof(float), sizeof(float));
+	OutHeightField.Samples.SetNumUninitialized(Desc.ChunkSamples * Desc.ChunkSamples);
+	FMemory::Memcpy(OutHeightField.Samples.GetData(), RecordData + 2 * sizeof(float), OutHeightField.Samples.Num() * sizeof(uint16));
+	OutApron.Samples.SetNumUninitialized(FQuantizedApron::NumSamples(Desc.ChunkSamples, Desc.ChunkSamples));
+	FMemory::Memcpy(OutApron.Samples.GetData(), RecordData + ApronOffset(Desc), OutApron.Samples.Num() * sizeof(uint16));
+	return true;
+}
+
+bool FBakedWorldReader::ReadClasses(FIntPoint ChunkCoord, TArray<uint8>& OutClasses) const {
+	const uint8* RecordData = Desc.HasClasses() ? FindRecord(ChunkCoord) : nullptr;
+	if (!RecordData) {
+		return false;
+	}
+	OutClasses.SetNumUninitialized(Desc.ChunkSamples * Desc.ChunkSamples);
+	FMemory::Memcpy(OutClasses.GetData(), RecordData + ClassesOffset(Desc), OutClasses.Num());
+	return true;
+}
+
+bool FBakedWorldReader::ReadLodElevations(FIntPoint ChunkCoord, int LodStep, TArray<float>& OutElevations) const {
+	const int LodIndex = Desc.LodSteps.IndexOfByKey(LodStep);
+	const uint8* RecordData = LodIndex != INDEX_NONE ? FindRecord(ChunkCoord) : nullptr;
+	if (!RecordData) {
+		return false;
+	}
+	OutElevations.SetNumUninitialized(FMath::Square(VerticesPerSide(Desc.ChunkSamples, LodStep)));
+	FMemory::Memcpy(OutElevations.GetData(), RecordData + LodOffset(Desc, LodIndex), OutElevations.Num() * sizeof(float));
+	return true;
+}
@@ -0,0 +1,332 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "TerrainBenchmark.h"
+#include "NoiseKernel.h"
+#include "NoiseMap.h"
+#include "TerrainMeshing.h"
+#include "TerrainTexturing.h"
+#include "TerrainPipeline.h"
+#include "NoiseGraph.h"
+#include "HAL/PlatformTime.h"
+#include "Math/RandomStream.h"
+
+namespace {
+	constexpr float BenchmarkScale = 60.;
+	constexpr float BenchmarkPersistance = 0.5;
+	constexpr float BenchmarkLacunarity = 2.0;
+	constexpr float BenchmarkTileSize = 3.0;
+
+	template<typename FunctionType>
+	double TimeIterations(int Iterations, FunctionType&& Function) {
+		const double Start = FPlatformTime::Seconds();
+		for (int Iteration = 0; Iteration < Iterations; ++Iteration) {
+			Function();
+		}
+		return FPlatformTime::Seconds() - Start;
+	}
+
+	// Domain warped ridged mountains and billowy hills, mixed by a low frequency mask
+	FNoiseGraph BenchmarkGraph(int Octaves) {
+		FNoiseGraph Graph;
+		Graph.Nodes.SetNum(8);
+		Graph.Nodes[0].Frequency = 0.5;
+		Graph.Nodes[1].SeedOffset = 1;
+		Graph.Nodes[1].Frequency = 0.5;
+		Graph.Nodes[2].Backend = ENoiseBackend::OpenSimplex2;
+		Graph.Nodes[2].SeedOffset = 2;
+		Graph.Nodes[2].Octaves = Octaves;
+		Graph.Nodes[2].Lacunarity = BenchmarkLacunarity;
+		Graph.Nodes[2].WarpX = 0;
+		Graph.Nodes[2].WarpY = 1;
+		Graph.Nodes[2].WarpStrength = 20.;
+		Graph.Nodes[3].Op = ENoiseNodeOp::Ridged;
+		Graph.Nodes[3].Input = 2;
+		Graph.Nodes[4].SeedOffset = 3;
+		Graph.Nodes[4].Octaves = Octaves;
+		Graph.Nodes[4].Lacunarity = BenchmarkLacunarity;
+		Graph.Nodes[5].Op = ENoiseNodeOp::Billow;
+		Graph.Nodes[5].Input = 4;
+		Graph.Nodes[5].OutputScale = 0.3;
+		Graph.Nodes[6].SeedOffset = 4;
+		Graph.Nodes[6].Frequency = 0.25;
+		Graph.Nodes[7].Op = ENoiseNodeOp::Blend;
+		Graph.Nodes[7].BlendMode = ENoiseBlendMode::Lerp;
+		Graph.Nodes[7].Input = 5;
+		Graph.Nodes[7].Other = 3;
+		Graph.Nodes[7].Alpha = 6;
+		check(Graph.Validate());
+		return Graph;
+	}
+
+	TArray<FTerrainLayer> BenchmarkLayers() {
+		return {
+			{ 0.1f, FColor(0, 0, 255) },
+			{ 0.3f, FColor(255, 255, 0) },
+			{ 0.6f, FColor(0, 255, 0) },
+			{ 0.9f, FColor(69, 50, 0) },
+			{ 999.0f, FColor(255, 255, 255) }
+		};
+	}
+}
+
+namespace TerrainBenchmark {
+	void RunNoiseKernels(int Width, int Octaves, int Iterations) {
+		const int Height = Width;
+
+		FRandomStream RandomStream(0);
+		TArray<float> SampleXs;
+		SampleXs.SetNumUninitialized(Octaves * Width);
+		TArray<float> SampleYs;
+		SampleYs.SetNumUninitialized(Octaves * Height);
+		TArray<float> Amplitudes;
+		Amplitudes.SetNumUninitialized(Octaves);
+		float Amplitude = 1.;
+		float Frequency = 1.;
+		for (int I = 0; I < Octaves; ++I) {
+			const float OffsetX = RandomStream.FRandRange(-100000, 100000);
+			const float OffsetY = RandomStream.FRandRange(-100000, 100000);
+			for (int X = 0; X < Width; ++X) {
+				SampleXs[I * Width + X] = (X + OffsetX) / BenchmarkScale * Frequency;
+			}
+			for (int Y = 0; Y < Height; ++Y) {
+				SampleYs[I * Height + Y] = (Y + OffsetY) / BenchmarkScale * Frequency;
+			}
+			Amplitudes[I] = Amplitude;
+			Amplitude *= BenchmarkPersistance;
+			Frequency *= BenchmarkLacunarity;
+		}
+
+		TArray<float> Reference;
+		for (int KernelIndex = 0; KernelIndex < static_cast<int>(ENoiseKernel::Count); ++KernelIndex) {
+			const ENoiseKernel Kernel = static_cast<ENoiseKernel>(KernelIndex);
+			if (!NoiseKernel::IsSupported(Kernel)) {
+				UE_LOG(LogTemp, Display, TEXT("%-9s: not supported on this CPU"), NoiseKernel::ToString(Kernel));
+				continue;
+			}
+
+			TArray<float> Heights;
+			Heights.SetNumUninitialized(Width * Height);
+			const double Seconds = TimeIterations(Iterations, [&]() {
+				FMemory::Memzero(Heights.GetData(), Heights.Num() * sizeof(float));
+				for (int Y = 0; Y < Height; ++Y) {
+					for (int I = 0; I < Octaves; ++I) {
+						NoiseKernel::AccumulateOctaveRow(Kernel, &SampleXs[I * Width], SampleYs[I * Height + Y], Amplitudes[I], &Heights[Y * Width], Width);
+					}
+				}
+			});
+
+			if (Kernel == ENoiseKernel::Reference) {
+				Reference = Heights;
+			}
+			float MaxError = 0.;
+			for (int I = 0; I < Heights.Num(); ++I) {
+				MaxError = std::max(MaxError, FMath::Abs(Heights[I] - Reference[I]));
+			}
+
+			const double Samples = (double)Width * Height * Octaves * Iterations;
+			UE_LOG(LogTemp, Display, TEXT("%-9s: %8.2f M octave-samples/s, max error %g (tolerance %g)%s"),
+				NoiseKernel::ToString(Kernel),
+				Samples / Seconds / 1e6,
+				MaxError,
+				NoiseKernel::Tolerance,
+				MaxError > NoiseKernel::Tolerance ? TEXT(" FAILED") : TEXT("")
+			);
+		}
+	}
+
+	void RunNoiseBackends(int Width, int Iterations) {
+		const int Height = Width;
+		const ENoiseKernel Kernel = NoiseKernel::BestSupported();
+		UE_LOG(LogTemp, Display, TEXT("Kernel %s, %dx%d samples"), NoiseKernel::ToString(Kernel), Width, Height);
+		UE_LOG(LogTemp, Display, TEXT("%-12s %7s %10s %10s %7s %10s %8s %8s %8s %8s %10s"),
+			TEXT("Backend"), TEXT("Octaves"), TEXT("Unrolled"), TEXT("Per octave"), TEXT("Speedup"), TEXT("Max error"),
+			TEXT("Min"), TEXT("Max"), TEXT("Mean"), TEXT("StdDev"), TEXT("Diag/axis"));
+
+		for (int BackendIndex = 0; BackendIndex < static_cast<int>(ENoiseBackend::Count); ++BackendIndex) {
+			const ENoiseBackend Backend = static_cast<ENoiseBackend>(BackendIndex);
+			for (const int Octaves : { 1, 2, 3, 4, 5, 6, 7, 8, 12 }) {
+				FNoiseOctaves NoiseOctaves;
+				NoiseOctaves.Init(0, Width, Height, BenchmarkScale, Octaves, BenchmarkPersistance, BenchmarkLacunarity, FVector2D(0, 0), Backend);
+
+				TArray<float> Heights;
+				Heights.SetNumUninitialized(Width * Height);
+				const double UnrolledSeconds = TimeIterations(Iterations, [&]() {
+					for (int Y = 0; Y < Height; ++Y) {
+						NoiseOctaves.SumRow(Kernel, Y, &Heights[Y * Width]);
+					}
+				});
+
+				// `Reference` always takes the one pass per octave path
+				TArray<float> PerOctave;
+				PerOctave.SetNumUninitialized(Width * Height);
+				const double PerOctaveSeconds = TimeIterations(Iterations, [&]() {
+					for (int Y = 0; Y < Height; ++Y) {
+						NoiseOctaves.SumRow(ENoiseKernel::Reference, Y, &PerOctave[Y * Width]);
+					}
+				});
+
+				float MaxError = 0.;
+				float MinValue = TNumericLimits<float>::Max();
+				float MaxValue = TNumericLimits<float>::Lowest();
+				double Sum = 0.;
+				double SumSquares = 0.;
+				for (int I = 0; I < Heights.Num(); ++I) {
+					MaxError = std::max(MaxError, FMath::Abs(Heights[I] - PerOctave[I]));
+					MinValue = std::min(MinValue, Heights[I]);
+					MaxValue = std::max(MaxValue, Heights[I]);
+					Sum += Heights[I];
+					SumSquares += (double)Heights[I] * Heights[I];
+				}
+				const double Mean = Sum / Heights.Num();
+				const double StdDev = FMath::Sqrt(FMath::Max(SumSquares / Heights.Num() - Mean * Mean, 0.));
+
+				// Mean neighbor difference along the diagonals over the one along the axes, scaled by the step
+				// length. Isotropic noise lands near 1, grid aligned artifacts push it away.
+				double AxisDifference = 0.;
+				double DiagonalDifference = 0.;
+				for (int Y = 0; Y + 1 < Height; ++Y) {
+					for (int X = 0; X + 1 < Width; ++X) {
+						const float Here = Heights[Y * Width + X];
+						AxisDifference += FMath::Abs(Heights[Y * Width + X + 1] - Here) + FMath::Abs(Heights[(Y + 1) * Width + X] - Here);
+						DiagonalDifference += FMath::Abs(Heights[(Y + 1) * Width + X + 1] - Here) + FMath::Abs(Heights[(Y + 1) * Width + X] - Heights[Y * Width + X + 1]);
+					}
+				}
+				const double DiagonalRatio = AxisDifference > 0. ? DiagonalDifference / (AxisDifference * UE_DOUBLE_SQRT_2) : 0.;
+
+				const double Samples = (double)Width * Height * Octaves * Iterations;
+				UE_LOG(LogTemp, Display, TEXT("%-12s %7d %8.2f M %8.2f M %6.2fx %10g %8.3f %8.3f %8.3f %8.3f %10.3f"),
+					NoiseKernel::ToString(Backend),
+					Octaves,
+					Samples / UnrolledSeconds / 1e6,
+					Samples / PerOctaveSeconds / 1e6,
+					PerOctaveSeconds / UnrolledSeconds,
+					MaxError,
+					MinValue,
+					MaxValue,
+					Mean,
+					StdDev,
+					DiagonalRatio
+				);
+			}
+		}
+	}
+
+	TArray<FTerrainBenchmarkResult> RunSuite(const FTerrainBenchmarkConfig& Config) {
+		TArray<FTerrainBenchmarkResult> Results;
+		FTerrainClassifier Classifier;
+		Classifier.Build(BenchmarkLayers(), NoiseMap::NormalizedRange(ENormalizeMode::Global));
+
+		for (const int ChunkSize : Config.ChunkSizes) {
+			const double ChunkSamples = (double)ChunkSize * ChunkSize;
+
+			NoiseMap Noise;
+			for (const ENoiseBackend Backend : Config.Backends) {
+				for (const int Octaves : Config.Octaves) {
+					for (const ENoiseThreading Threading : { ENoiseThreading::Serial, ENoiseThreading::Parallel }) {
+						const double Seconds = TimeIterations(Config.Iterations, [&]() {
+							Noise.Init(ENormalizeMode::Global, 0, ChunkSize, ChunkSize, BenchmarkScale, Octaves, BenchmarkPersistance, BenchmarkLacunarity, FVector2D(0, 0), Threading, Backend);
+						});
+						const bool bParallel = Threading == ENoiseThreading::Parallel;
+						Results.Add({
+							Backend == ENoiseBackend::Perlin
+								? FString(bParallel ? TEXT("Noise (parallel)") : TEXT("Noise"))
+								: FString::Printf(TEXT("Noise (%s%s)"), NoiseKernel::ToString(Backend), bParallel ? TEXT(", parallel") : TEXT("")),
+							ChunkSize,
+							Octaves,
+							1,
+							ChunkSamples * Config.Iterations / Seconds,
+							TEXT("samples")
+						});
+					}
+				}
+			}
+
+			FElevationLut Elevation;
+			Elevation.Bake([](float NoiseValue) { return NoiseValue; }, NoiseMap::NormalizedRange(ENormalizeMode::Global), FElevationLut::DefaultResolution, 100.f);
+			TArray<FVector> Vertices;
+			TArray<FVector2D> Uv0;
+			TArray<int32> Triangles;
+			for (const int StepSize : Config.StepSizes) {
+				if ((ChunkSize - 1) % StepSize != 0) {
+					continue;
+				}
+				const FTerrainGrid Grid{ ChunkSize, ChunkSize, StepSize, BenchmarkTileSize, FVector(0.) };
+				const double Seconds = TimeIterations(Config.Iterations, [&]() {
+					TerrainMeshing::BuildVertices(Grid, Noise.NoiseValues, Elevation, Vertices, Uv0);
+					TerrainMeshing::BuildTriangles(Grid, Triangles);
+				});
+				Results.Add({ TEXT("Meshing"), ChunkSize, 0, StepSize, (double)Grid.NumVertices() * Config.Iterations / Seconds, TEXT("vertices") });
+			}
+
+			TArray<uint8> TextureData;
+			TextureData.SetNumZeroed(ChunkSize * ChunkSize * TerrainTexturing::BytesPerTexel);
+			const double ColorSeconds = TimeIterations(Config.Iterations, [&]() {
+				TerrainTexturing::WriteColors(Noise.NoiseValues, Classifier, TextureData.GetData());
+			});
+			Results.Add({ TEXT("Texturing"), ChunkSize, 0, 1, ChunkSamples * Config.Iterations / ColorSeconds, TEXT("texels") });
+
+			const double IndexSeconds = TimeIterations(Config.Iterations, [&]() {
+				TerrainTexturing::WriteIndices(Noise.NoiseValues, Classifier, TextureData.GetData());
+			});
+			Results.Add({ TEXT("Texturing (index)"), ChunkSize, 0, 1, ChunkSamples * Config.Iterations / IndexSeconds, TEXT("texels") });
+
+			// Whole first generation of a chunk: noise, heightfield, color texels and a full resolution mesh,
+			// as separate passes over the float map against `TerrainPipeline`
+			const FTerrainGrid ChunkGrid{ ChunkSize, ChunkSize, 1, BenchmarkTileSize, FVector(0.) };
+			for (const int Octaves : Config.Octaves) {
+				for (const ENormalizeMode NormalizeMode : { ENormalizeMode::Global, ENormalizeMode::Local }) {
+					const bool bGlobal = NormalizeMode == ENormalizeMode::Global;
+					FQuantizedHeightfield HeightField;
+					const double MultiPassSeconds = TimeIterations(Config.Iterations, [&]() {
+						Noise.Init(NormalizeMode, 0, ChunkSize, ChunkSize, BenchmarkScale, Octaves, BenchmarkPersistance, BenchmarkLacunarity, FVector2D(0, 0));
+						HeightField.Quantize(Noise.NoiseValues, ChunkSize, ChunkSize, NoiseMap::NormalizedRange(NormalizeMode));
+						TerrainTexturing::WriteColors(Noise.NoiseValues, Classifier, TextureData.GetData());
+						TerrainMeshing::BuildVertices(ChunkGrid, Noise.NoiseValues, Elevation, Vertices, Uv0);
+					});
+					Results.Add({ bGlobal ? TEXT("Multi-pass") : TEXT("Multi-pass (local)"), ChunkSize, Octaves, 1, ChunkSamples * Config.Iterations / MultiPassSeconds, TEXT("samples") });
+
+					FChunkPipelineDesc Desc;
+					Desc.NormalizeMode = NormalizeMode;
+					Desc.Scale = BenchmarkScale;
+					Desc.Octaves = Octaves;
+					Desc.Persistance = BenchmarkPersistance;
+					Desc.Lacunarity = BenchmarkLacunarity;
+					Desc.Grid = ChunkGrid;
+					Desc.Elevation = &Elevation;
+					Desc.Classifier = &Classifier;
+					Desc.Texels = EPipelineTexels::Color;
+					FChunkPipelineOutput Output;
+					const double FusedSeconds = TimeIterations(Config.Iterations, [&]() {
+						TerrainPipeline::BuildChunk(Desc, Output);
+					});
+					Results.Add({ bGlobal ? TEXT("Fused") : TEXT("Fused (local)"), ChunkSize, Octaves, 1, ChunkSamples * Config.Iterations / FusedSeconds, TEXT("samples") });
+
+					if (bGlobal) {
+						const FNoiseGraph Graph = BenchmarkGraph(Octaves);
+						Desc.Graph = &Graph;
+						const double GraphSeconds = TimeIterations(Config.Iterations, [&]() {
+							TerrainPipeline::BuildChunk(Desc, Output);
+						});
+						Results.Add({ TEXT("Fused (graph)"), ChunkSize, Octaves, 1, ChunkSamples * Config.Iterations / GraphSeconds, TEXT("samples") });
+					}
+				}
+			}
+		}
+
+		return Results;
+	}
+
+	void LogResults(const TArray<FTerrainBenchmarkResult>& Results) {
+		UE_LOG(LogTemp, Display, TEXT("%-30s %6s %7s %4s %14s"), TEXT("Stage"), TEXT("Size"), TEXT("Octaves"), TEXT("Lod"), TEXT("M items/s"));
+		for (const FTerrainBenchmarkResult& Result : Results) {
+			UE_LOG(LogTemp, Display, TEXT("%-30s %6d %7d %4d %10.2f M %s/s"),
+				*Result.Stage,
+				Result.ChunkSize,
+				Result.Octaves,
+				Result.StepSize,
+				Result.ItemsPerSecond / 1e6,
+				Result.Unit
+			);
+		}
+	}
+}
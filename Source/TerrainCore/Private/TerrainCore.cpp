@@ -0,0 +1,4 @@
+#include "TerrainCore.h"
+#include "Modules/ModuleManager.h"
+
+IMPLEMENT_MODULE(FDefaultModuleImpl, TerrainCore);
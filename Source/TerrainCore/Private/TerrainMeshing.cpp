@@ -0,0 +1,227 @@
+#include "TerrainMeshing.h"
+#include "Math/VectorRegister.h"
+
+namespace TerrainMeshing {
+	void BuildVertices(const FTerrainGrid& Grid, TArrayView<const float> Heights, const FElevationLut& Elevation, TArray<FVector>& Vertices, TArray<FVector2D>& Uv0) {
+		check(Heights.Num() == Grid.Width * Grid.Height);
+		check((Grid.Width - 1) % Grid.StepSize == 0 && (Grid.Height - 1) % Grid.StepSize == 0);
+		check(!Elevation.IsEmpty());
+
+		Vertices.SetNumUninitialized(Grid.NumVertices());
+		Uv0.SetNumUninitialized(Grid.NumVertices());
+		for (int Y = 0; Y < Grid.Height; Y += Grid.StepSize) {
+			BuildVertexRow(Grid, Y, &Heights[Y * Grid.Width], Elevation, Vertices.GetData(), Uv0.GetData());
+		}
+	}
+
+	void BuildVertexRow(const FTerrainGrid& Grid, int Y, const float* RowHeights, const FElevationLut& Elevation, FVector* Vertices, FVector2D* Uv0) {
+		checkSlow(Y % Grid.StepSize == 0);
+
+		int VertexIndex = Y / Grid.StepSize * Grid.VerticesPerRow();
+		const float YPos = Y * Grid.TileSize;
+		const float V = (float)Y / Grid.Width;
+		for (int X = 0; X < Grid.Width; X += Grid.StepSize) {
+			const float XPos = X * Grid.TileSize;
+			Vertices[VertexIndex] = FVector(Grid.Origin.X + XPos, Grid.Origin.Y + YPos, Grid.Origin.Z + Elevation.Sample(RowHeights[X]));
+
+			const float U = (float)X / Grid.Width;
+			Uv0[VertexIndex] = FVector2D(U, V);
+			++VertexIndex;
+		}
+	}
+
+	void BuildElevations(const FTerrainGrid& Grid, TArrayView<const float> Heights, const FElevationLut& Elevation, TArray<float>& Elevations) {
+		check(Heights.Num() == Grid.Width * Grid.Height);
+		check((Grid.Width - 1) % Grid.StepSize == 0 && (Grid.Height - 1) % Grid.StepSize == 0);
+		check(!Elevation.IsEmpty());
+
+		Elevations.Reset(Grid.NumVertices());
+		for (int Y = 0; Y < Grid.Height; Y += Grid.StepSize) {
+			for (int X = 0; X < Grid.Width; X += Grid.StepSize) {
+				Elevations.Add(Elevation.Sample(Heights[Y * Grid.Width + X]));
+			}
+		}
+	}
+
+	void BuildVerticesFromElevations(const FTerrainGrid& Grid, TArrayView<const float> Elevations, TArray<FVector>& Vertices, TArray<FVector2D>& Uv0) {
+		check(Elevations.Num() == Grid.NumVertices());
+
+		Vertices.Reset(Grid.NumVertices());
+		Uv0.Reset(Grid.NumVertices());
+		int VertexIndex = 0;
+		for (int Y = 0; Y < Grid.Height; Y += Grid.StepSize) {
+			for (int X = 0; X < Grid.Width; X += Grid.StepSize) {
+				const float XPos = X * Grid.TileSize;
+				const float YPos = Y * Grid.TileSize;
+				Vertices.Add(FVector(Grid.Origin.X + XPos, Grid.Origin.Y + YPos, Grid.Origin.Z + Elevations[VertexIndex++]));
+
+				const float U = (float)X / Grid.Width;
+				const float V = (float)Y / Grid.Width;
+				Uv0.Add(FVector2D(U, V));
+			}
+		}
+	}
+
+	void BuildNormals(const FTerrainGrid& Grid, const FQuantizedHeightfield& HeightField, const FHeightApron& Apron, const FElevationLut& Elevation, TArray<FVector>& Normals, TArray<FVector>& Tangents) {
+		check(HeightField.Width == Grid.Width && HeightField.Height == Grid.Height);
+		check(Apron.IsEmpty() || (Apron.Top.Num() == Grid.Width + 2 && Apron.Left.Num() == Grid.Height));
+		check(!Elevation.IsEmpty());
+
+		const int Width = Grid.Width;
+		const int Height = Grid.Height;
+		const bool bHasApron = !Apron.IsEmpty();
+
+		// Elevated rows padded to x = -1 .. Width, so every difference is two plain loads. Three slots hold rows
+		// y - 1, y and y + 1, rows shared by neighboring vertex rows are only elevated once. Without an apron the
+		// padding extrapolates the border, which turns the centered difference into the one sided one scaled up.
+		const int AlignedWidth = Align(Width, 4);
+		const int RowStride = AlignedWidth + 4;
+		TArray<float, TInlineAllocator<3 * (256 + 4)>> RowStorage;
+		RowStorage.SetNumZeroed(3 * RowStride);
+		int RowTags[3] = { INDEX_NONE - 2, INDEX_NONE - 2, INDEX_NONE - 2 };
+		auto AcquireRow = [&](int RowY, int Y, bool& bOutFresh) {
+			int Slot = INDEX_NONE;
+			for (int S = 0; S < 3; ++S) {
+				if (RowTags[S] == RowY) {
+					bOutFresh = false;
+					return &RowStorage[S * RowStride];
+				}
+				if (FMath::Abs(RowTags[S] - Y) > 1) {
+					Slot = S;
+				}
+			}
+			check(Slot != INDEX_NONE);
+			RowTags[Slot] = RowY;
+			bOutFresh = true;
+			return &RowStorage[Slot * RowStride];
+		};
+		auto ElevateRow = [&](int RowY, float* Out) {
+			if (RowY < 0 || RowY >= Height) {
+				const TArray<float>& Edge = RowY < 0 ? Apron.Top : Apron.Bottom;
+				for (int P = 0; P < Width + 2; ++P) {
+					Out[P] = Elevation.Sample(Edge[P]);
+				}
+				return;
+			}
+			for (int X = 0; X < Width; ++X) {
+				Out[X + 1] = Elevation.Sample(HeightField.GetSample(X, RowY));
+			}
+			Out[0] = bHasApron ? Elevation.Sample(Apron.Left[RowY]) : 2 * Out[1] - Out[2];
+			Out[Width + 1] = bHasApron ? Elevation.Sample(Apron.Right[RowY]) : 2 * Out[Width] - Out[Width - 1];
+		};
+		auto Extrapolate = [&](const float* Border, const float* Inner, float* Out) {
+			for (int P = 0; P < Width + 2; ++P) {
+				Out[P] = 2 * Border[P] - Inner[P];
+			}
+		};
+
+		// Differences of every sample of the row 4 at a time, then compacted to the vertex columns and normalized
+		// 4 vertices at a time
+		const int VerticesPerRow = Grid.VerticesPerRow();
+		const int PaddedRow = Align(VerticesPerRow, 4);
+		TArray<float, TInlineAllocator<256>> Dx;
+		TArray<float, TInlineAllocator<256>> Dy;
+		TArray<float, TInlineAllocator<256 * 4>> Out;
+		Dx.SetNumZeroed(AlignedWidth);
+		Dy.SetNumZeroed(AlignedWidth);
+		Out.SetNumUninitialized(PaddedRow * 4);
+
+		// Differences are over two samples
+		const float SpanX = 2 * Grid.TileSize;
+		const VectorRegister4Float SpanSquared = VectorSetFloat1(SpanX * SpanX);
+		const VectorRegister4Float Span = VectorSetFloat1(SpanX);
+
+		Normals.SetNumUninitialized(Grid.NumVertices());
+		Tangents.SetNumUninitialized(Grid.NumVertices());
+		int VertexIndex = 0;
+		for (int Y = 0; Y < Height; Y += Grid.StepSize) {
+			bool bFreshCurrent, bFreshPrevious, bFreshNext;
+			float* Current = AcquireRow(Y, Y, bFreshCurrent);
+			float* Previous = AcquireRow(Y - 1, Y, bFreshPrevious);
+			float* Next = AcquireRow(Y + 1, Y, bFreshNext);
+			const bool bExtrapolatePrevious = !bHasApron && Y == 0;
+			const bool bExtrapolateNext = !bHasApron && Y == Height - 1;
+			if (bFreshCurrent) {
+				ElevateRow(Y, Current);
+			}
+			if (bFreshPrevious && !bExtrapolatePrevious) {
+				ElevateRow(Y - 1, Previous);
+			}
+			if (bFreshNext && !bExtrapolateNext) {
+				ElevateRow(Y + 1, Next);
+			}
+			if (bFreshPrevious && bExtrapolatePrevious) {
+				Extrapolate(Current, Next, Previous);
+			}
+			if (bFreshNext && bExtrapolateNext) {
+				Extrapolate(Current, Previous, Next);
+			}
+
+			for (int X = 0; X < AlignedWidth; X += 4) {
+				VectorStore(VectorSubtract(VectorLoad(&Current[X + 2]), VectorLoad(&Current[X])), &Dx[X]);
+				VectorStore(VectorSubtract(VectorLoad(&Next[X + 1]), VectorLoad(&Previous[X + 1])), &Dy[X]);
+			}
+			if (Grid.StepSize > 1) {
+				// In place, vertex V reads sample V * StepSize which is never behind it
+				for (int V = 0; V < VerticesPerRow; ++V) {
+					Dx[V] = Dx[V * Grid.StepSize];
+					Dy[V] = Dy[V * Grid.StepSize];
+				}
+			}
+
+			// Normal (-Dx, -Dy, Span) and tangent (Span, 0, Dx), both normalized
+			for (int V = 0; V < PaddedRow; V += 4) {
+				const VectorRegister4Float DxV = VectorLoad(&Dx[V]);
+				const VectorRegister4Float DyV = VectorLoad(&Dy[V]);
+				const VectorRegister4Float DxSquared = VectorMultiply(DxV, DxV);
+				const VectorRegister4Float InvNormal = VectorReciprocalSqrt(VectorMultiplyAdd(DyV, DyV, VectorAdd(DxSquared, SpanSquared)));
+				const VectorRegister4Float InvTangent = VectorReciprocalSqrt(VectorAdd(DxSquared, SpanSquared));
+				VectorStore(VectorNegate(VectorMultiply(DxV, InvNormal)), &Out[V]);
+				VectorStore(VectorNegate(VectorMultiply(DyV, InvNormal)), &Out[PaddedRow + V]);
+				VectorStore(VectorMultiply(Span, InvNormal), &Out[2 * PaddedRow + V]);
+				VectorStore(VectorMultiply(Span, InvTangent), &Out[3 * PaddedRow + V]);
+				// Tangent Z reuses Dx storage, already consumed
+				VectorStore(VectorMultiply(DxV, InvTangent), &Dx[V]);
+			}
+
+			for (int V = 0; V < VerticesPerRow; ++V, ++VertexIndex) {
+				Normals[VertexIndex] = FVector(Out[V], Out[PaddedRow + V], Out[2 * PaddedRow + V]);
+				Tangents[VertexIndex] = FVector(Out[3 * PaddedRow + V], 0., Dx[V]);
+			}
+		}
+	}
+
+	void BuildTriangles(const FTerrainGrid& Grid, TArray<int32>& Triangles) {
+		const int VerticesPerRow = Grid.VerticesPerRow();
+		const int VerticesPerColumn = Grid.VerticesPerColumn();
+
+		Triangles.Reset(Grid.NumIndices());
+		for (int Y = 0; Y < VerticesPerColumn - 1; ++Y) {
+			for (int X = 0; X < VerticesPerRow - 1; ++X) {
+				const int CurrentIndex = Y * VerticesPerRow + X;
+				// Vertex setup
+				//   0      1      2      3    ..    W-1
+				// (0+W)  (1+W)  (2+W)  (3+W)  .. (2W - 1)
+				// ...
+
+				// Both triangles need to have counter-clockwise winding-order
+				//     X
+				//     |\
+				//     | \
+				// X+W --- x+W+1
+				Triangles.Add(CurrentIndex);
+				Triangles.Add(CurrentIndex + VerticesPerRow);
+				Triangles.Add(CurrentIndex + VerticesPerRow + 1);
+
+				// X --- X+1
+				//   \ |
+				//    \|
+				//     X+W+1
+				Triangles.Add(CurrentIndex);
+				Triangles.Add(CurrentIndex + VerticesPerRow + 1);
+				Triangles.Add(CurrentIndex + 1);
+			}
+		}
+		check(Triangles.Num() == Grid.NumIndices());
+	}
+}
@@ -0,0 +1,183 @@
+#include "TerrainPipeline.h"
+#include "Async/ParallelFor.h"
+
+namespace {
+	using TerrainPipeline::RowsPerBand;
+
+	// `NoiseSourceType` is `FNoiseOctaves` or `FNoiseGraphSampler`, initialized for the chunk's samples
+	template<typename NoiseSourceType>
+	void BuildChunkFrom(const FChunkPipelineDesc& Desc, const NoiseSourceType& NoiseOctaves, FChunkPipelineOutput& Out) {
+		const FTerrainGrid& Grid = Desc.Grid;
+		const int Width = Grid.Width;
+		const int Height = Grid.Height;
+		const ENoiseKernel Kernel = NoiseKernel::BestSupported();
+
+		Out.HeightField.Allocate(Width, Height, NoiseMap::NormalizedRange(Desc.NormalizeMode));
+		Out.Vertices.SetNumUninitialized(Grid.NumVertices());
+		Out.Uv0.SetNumUninitialized(Grid.NumVertices());
+		const int BytesPerTexel = Desc.Texels == EPipelineTexels::Color ? TerrainTexturing::BytesPerTexel : TerrainTexturing::BytesPerIndexTexel;
+		Out.Texels.SetNumUninitialized(Desc.Texels == EPipelineTexels::None ? 0 : Width * Height * BytesPerTexel);
+
+		const int NumBands = FMath::DivideAndRoundUp(Height, RowsPerBand);
+		const EParallelForFlags ParallelFlags = Desc.Threading == ENoiseThreading::Parallel ? EParallelForFlags::None : EParallelForFlags::ForceSingleThread;
+		// Per band, so workers never write the same flag
+		TArray<uint8> BandHasWater;
+		BandHasWater.SetNumZeroed(NumBands);
+
+		// Everything downstream of the normalized noise, for a single row
+		auto FinishRow = [&](int Y, const float* Row) {
+			const TArrayView<const float> RowView(Row, Width);
+			Out.HeightField.QuantizeRange(Y * Width, RowView);
+			switch (Desc.Texels) {
+				case EPipelineTexels::Color: {
+					BandHasWater[Y / RowsPerBand] |= TerrainTexturing::WriteColors(RowView, *Desc.Classifier, &Out.Texels[Y * Width * BytesPerTexel]);
+					break;
+				}
+				case EPipelineTexels::PaletteIndex: {
+					BandHasWater[Y / RowsPerBand] |= TerrainTexturing::WriteIndices(RowView, *Desc.Classifier, &Out.Texels[Y * Width * BytesPerTexel]);
+					break;
+				}
+				default: {
+					break;
+				}
+			}
+			if (Y % Grid.StepSize == 0) {
+				TerrainMeshing::BuildVertexRow(Grid, Y, Row, *Desc.Elevation, Out.Vertices.GetData(), Out.Uv0.GetData());
+			}
+		};
+
+		if (Desc.NormalizeMode == ENormalizeMode::Global) {
+			const FFloatInterval Bounds = NoiseOctaves.GlobalBounds();
+			ParallelFor(NumBands, [&](int Band) {
+				// Single row scratch, reused by every row of the band
+				TArray<float, TInlineAllocator<256>> Row;
+				Row.SetNumUninitialized(Width);
+				const int EndY = std::min(Height, (Band + 1) * RowsPerBand);
+				for (int Y = Band * RowsPerBand; Y < EndY; ++Y) {
+					NoiseOctaves.SumRow(Kernel, Y, Row.GetData());
+					for (int X = 0; X < Width; ++X) {
+						Row[X] = NoiseMap::InverseLerp(Bounds.Min, Bounds.Max, Row[X]);
+					}
+					FinishRow(Y, Row.GetData());
+				}
+			}, ParallelFlags);
+			Out.bHasWater = BandHasWater.Contains(1);
+			return;
+		}
+
+		// Same bounds reduction as `NoiseMap::Init`, so both agree on every sample
+		TArray<float> Raw;
+		Raw.SetNumUninitialized(Width * Height);
+		TArray<float> BandMinNoise;
+		BandMinNoise.SetNumUninitialized(NumBands);
+		TArray<float> BandMaxNoise;
+		BandMaxNoise.SetNumUninitialized(NumBands);
+		ParallelFor(NumBands, [&](int Band) {
+			float BandMax = TNumericLimits<float>::Lowest();
+			float BandMin = TNumericLimits<float>::Max();
+			const int EndY = std::min(Height, (Band + 1) * RowsPerBand);
+			for (int Y = Band * RowsPerBand; Y < EndY; ++Y) {
+				float* Row = &Raw[Y * Width];
+				NoiseOctaves.SumRow(Kernel, Y, Row);
+				for (int X = 0; X < Width; ++X) {
+					BandMax = std::max(BandMax, Row[X]);
+					BandMin = std::min(BandMin, Row[X]);
+				}
+			}
+			BandMaxNoise[Band] = BandMax;
+			BandMinNoise[Band] = BandMin;
+		}, ParallelFlags);
+
+		float MaxNoise = TNumericLimits<float>::Lowest();
+		float MinNoise = TNumericLimits<float>::Max();
+		for (int Band = 0; Band < NumBands; ++Band) {
+			MaxNoise = std::max(MaxNoise, BandMaxNoise[Band]);
+			MinNoise = std::min(MinNoise, BandMinNoise[Band]);
+		}
+
+		ParallelFor(NumBands, [&](int Band) {
+			const int EndY = std::min(Height, (Band + 1) * RowsPerBand);
+			for (int Y = Band * RowsPerBand; Y < EndY; ++Y) {
+				float* Row = &Raw[Y * Width];
+				for (int X = 0; X < Width; ++X) {
+					Row[X] = NoiseMap::InverseLerp(MinNoise, MaxNoise, Row[X]);
+				}
+				FinishRow(Y, Row);
+			}
+		}, ParallelFlags);
+		Out.bHasWater = BandHasWater.Contains(1);
+	}
+
+	// `NoiseOctaves` covers the chunk grown by a sample on every side
+	template<typename NoiseSourceType>
+	void BuildApronFrom(const FChunkPipelineDesc& Desc, const NoiseSourceType& NoiseOctaves, const FQuantizedHeightfield& HeightField, FQuantizedApron& Quantized) {
+		const int Width = Desc.Grid.Width;
+		const int Height = Desc.Grid.Height;
+		const ENoiseKernel Kernel = NoiseKernel::BestSupported();
+		const FFloatInterval Bounds = NoiseOctaves.GlobalBounds();
+		auto Finish = [&](TArray<float>& Samples) {
+			for (float& Sample : Samples) {
+				Sample = NoiseMap::InverseLerp(Bounds.Min, Bounds.Max, Sample);
+			}
+		};
+
+		FHeightApron Out;
+		Out.Top.SetNumUninitialized(Width + 2);
+		Out.Bottom.SetNumUninitialized(Width + 2);
+		NoiseOctaves.SumRow(Kernel, 0, Out.Top.GetData());
+		NoiseOctaves.SumRow(Kernel, Height + 1, Out.Bottom.GetData());
+
+		Out.Left.SetNumUninitialized(Height);
+		Out.Right.SetNumUninitialized(Height);
+		const int Columns[] = { 0, Width + 1 };
+		for (int Y = 0; Y < Height; ++Y) {
+			float Pair[2];
+			NoiseOctaves.SumColumns(Kernel, Y + 1, Columns, Pair);
+			Out.Left[Y] = Pair[0];
+			Out.Right[Y] = Pair[1];
+		}
+
+		Finish(Out.Top);
+		Finish(Out.Bottom);
+		Finish(Out.Left);
+		Finish(Out.Right);
+		Quantized.Quantize(Out, HeightField);
+	}
+}
+
+namespace TerrainPipeline {
+	void BuildChunk(const FChunkPipelineDesc& Desc, FChunkPipelineOutput& Out) {
+		const FTerrainGrid& Grid = Desc.Grid;
+		check((Grid.Width - 1) % Grid.StepSize == 0 && (Grid.Height - 1) % Grid.StepSize == 0);
+		check(Desc.Elevation && !Desc.Elevation->IsEmpty());
+		check(Desc.Texels == EPipelineTexels::None || Desc.Classifier);
+
+		if (Desc.Graph) {
+			FNoiseGraphSampler Sampler;
+			Sampler.Init(*Desc.Graph, Desc.Seed, Grid.Width, Grid.Height, Desc.Scale, Desc.NoiseOffset, Desc.SampleSpacing);
+			BuildChunkFrom(Desc, Sampler, Out);
+			return;
+		}
+		FNoiseOctaves NoiseOctaves;
+		NoiseOctaves.Init(Desc.Seed, Grid.Width, Grid.Height, Desc.Scale, Desc.Octaves, Desc.Persistance, Desc.Lacunarity, Desc.NoiseOffset, Desc.Backend, Desc.SampleSpacing);
+		BuildChunkFrom(Desc, NoiseOctaves, Out);
+	}
+
+	void BuildApron(const FChunkPipelineDesc& Desc, const FQuantizedHeightfield& HeightField, FQuantizedApron& Out) {
+		check(Desc.NormalizeMode == ENormalizeMode::Global);
+		const int Width = Desc.Grid.Width;
+		const int Height = Desc.Grid.Height;
+
+		// Grown by a sample on every side, so padded sample (X + 1, Y + 1) lands exactly on sample (X, Y)
+		const FVector2D PaddedOffset = Desc.NoiseOffset - FVector2D(Desc.SampleSpacing, Desc.SampleSpacing);
+		if (Desc.Graph) {
+			FNoiseGraphSampler Sampler;
+			Sampler.Init(*Desc.Graph, Desc.Seed, Width + 2, Height + 2, Desc.Scale, PaddedOffset, Desc.SampleSpacing);
+			BuildApronFrom(Desc, Sampler, HeightField, Out);
+			return;
+		}
+		FNoiseOctaves NoiseOctaves;
+		NoiseOctaves.Init(Desc.Seed, Width + 2, Height + 2, Desc.Scale, Desc.Octaves, Desc.Persistance, Desc.Lacunarity, PaddedOffset, Desc.Backend, Desc.SampleSpacing);
+		BuildApronFrom(Desc, NoiseOctaves, HeightField, Out);
+	}
+}
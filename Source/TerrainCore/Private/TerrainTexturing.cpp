@@ -0,0 +1,124 @@
+#include "TerrainTexturing.h"
+#include "Hash/CityHash.h"
+
+void FTerrainClassifier::Build(TArrayView<const FTerrainLayer> Layers, FFloatInterval Domain, int Resolution) {
+	check(Domain.Max > Domain.Min);
+	checkf(Layers.Num() < TerrainTexturing::PaletteTextureWidth - 1, TEXT("Too many terrain layers for an 8 bit index"));
+	Resolution = FMath::Max(Resolution, 1);
+
+	const float CellSize = (Domain.Max - Domain.Min) / Resolution;
+	DomainMin = Domain.Min;
+	InvCellSize = 1. / CellSize;
+	MaxCell = Resolution - 1;
+
+	CellLayers.SetNumUninitialized(Resolution);
+	CellBoundaries.SetNumUninitialized(Resolution);
+	for (int Cell = 0; Cell < Resolution; ++Cell) {
+		const float CellMin = Domain.Min + Cell * CellSize;
+		int Layer = 0;
+		while (Layer < Layers.Num() && CellMin > Layers[Layer].MaxHeight) {
+			++Layer;
+		}
+		CellLayers[Cell] = Layer;
+		// Nothing left to step into above the last layer
+		CellBoundaries[Cell] = Layer < Layers.Num() ? Layers[Layer].MaxHeight : MAX_flt;
+	}
+
+	Palette.Reset(Layers.Num() + 1);
+	for (const FTerrainLayer& Layer : Layers) {
+		Palette.Add(FColor(Layer.Color.R, Layer.Color.G, Layer.Color.B, 255));
+	}
+	Palette.Add(FColor(0, 0, 0, 0));
+
+	WaterLayers.Reset(Layers.Num() + 1);
+	for (const FTerrainLayer& Layer : Layers) {
+		WaterLayers.Add(Layer.bWater);
+	}
+	WaterLayers.Add(false);
+}
+
+uint64 FTerrainClassifier::GetHash() const {
+	uint64 Hash = CityHash64(reinterpret_cast<const char*>(CellLayers.GetData()), CellLayers.Num());
+	Hash = CityHash64WithSeed(reinterpret_cast<const char*>(CellBoundaries.GetData()), CellBoundaries.Num() * sizeof(float), Hash);
+	Hash = CityHash64WithSeed(reinterpret_cast<const char*>(Palette.GetData()), Palette.Num() * sizeof(FColor), Hash);
+	return Hash != 0 ? Hash : 1;
+}
+
+namespace TerrainTexturing {
+	bool WriteColors(TArrayView<const float> Heights, const FTerrainClassifier& Classifier, uint8* OutTexels) {
+		check(!Classifier.IsEmpty());
+		const FColor* Palette = Classifier.GetPalette().GetData();
+		bool bWater = false;
+		for (int NoiseIndex = 0; NoiseIndex < Heights.Num(); ++NoiseIndex) {
+			const uint8 Layer = Classifier.Classify(Heights[NoiseIndex]);
+			const FColor Color = Palette[Layer];
+			const int TextureIndex = NoiseIndex * BytesPerTexel;
+
+			OutTexels[TextureIndex] = Color.B;
+			OutTexels[TextureIndex + 1] = Color.G;
+			OutTexels[TextureIndex + 2] = Color.R;
+			OutTexels[TextureIndex + 3] = Color.A;
+			bWater |= Classifier.IsWater(Layer);
+		}
+		return bWater;
+	}
+
+	bool WriteColorsFromIndices(TArrayView<const uint8> Indices, const FTerrainClassifier& Classifier, uint8* OutTexels) {
+		const TArray<FColor>& Palette = Classifier.GetPalette();
+		bool bWater = false;
+		for (int TexelIndex = 0; TexelIndex < Indices.Num(); ++TexelIndex) {
+			const FColor Color = Palette[Indices[TexelIndex]];
+			const int TextureIndex = TexelIndex * BytesPerTexel;
+
+			OutTexels[TextureIndex] = Color.B;
+			OutTexels[TextureIndex + 1] = Color.G;
+			OutTexels[TextureIndex + 2] = Color.R;
+			OutTexels[TextureIndex + 3] = Color.A;
+			bWater |= Classifier.IsWater(Indices[TexelIndex]);
+		}
+		return bWater;
+	}
+
+	bool WriteIndices(TArrayView<const float> Heights, const FTerrainClassifier& Classifier, uint8* OutTexels) {
+		check(!Classifier.IsEmpty());
+		bool bWater = false;
+		for (int NoiseIndex = 0; NoiseIndex < Heights.Num(); ++NoiseIndex) {
+			const uint8 Layer = Classifier.Classify(Heights[NoiseIndex]);
+			OutTexels[NoiseIndex] = Layer;
+			bWater |= Classifier.IsWater(Layer);
+		}
+		return bWater;
+	}
+
+	bool HasWater(TArrayView<const uint8> Indices, const FTerrainClassifier& Classifier) {
+		for (const uint8 Layer : Indices) {
+			if (Classifier.IsWater(Layer)) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void WriteGrayscale(TArrayView<const float> Heights, uint8* OutTexels) {
+		for (int NoiseIndex = 0; NoiseIndex < Heights.Num(); ++NoiseIndex) {
+			const uint8 NoiseTexColor = Heights[NoiseIndex] * 255.;
+			const int TextureIndex = NoiseIndex * BytesPerTexel;
+
+			OutTexels[TextureIndex] = NoiseTexColor;
+			OutTexels[TextureIndex + 1] = NoiseTexColor;
+			OutTexels[TextureIndex + 2] = NoiseTexColor;
+			OutTexels[TextureIndex + 3] = 255;
+		}
+	}
+
+	void WritePalette(const FTerrainClassifier& Classifier, uint8* OutTexels) {
+		FMemory::Memzero(OutTexels, PaletteTextureWidth * BytesPerTexel);
+		const TArray<FColor>& Palette = Classifier.GetPalette();
+		for (int Index = 0; Index < Palette.Num(); ++Index) {
+			OutTexels[Index * BytesPerTexel] = Palette[Index].B;
+			OutTexels[Index * BytesPerTexel + 1] = Palette[Index].G;
+			OutTexels[Index * BytesPerTexel + 2] = Palette[Index].R;
+			OutTexels[Index * BytesPerTexel + 3] = Palette[Index].A;
+		}
+	}
+}
@@ -0,0 +1,270 @@
+#include "TerrainTileCache.h"
+#include "Async/MappedFileHandle.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/Crc.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+
+namespace {
+	constexpr uint32 TileMagic = 0x4C495454; // "TTIL"
+
+	struct FTileHeader {
+		uint32 Magic;
+		uint32 Version;
+		uint64 ParamsHash;
+		int32 ChunkX;
+		int32 ChunkY;
+		int32 Width;
+		int32 Height;
+		float MinHeight;
+		float MaxHeight;
+		uint32 PayloadCrc;
+		uint32 Padding;
+	};
+	static_assert(sizeof(FTileHeader) == 48, "Tile header layout is part of the file format");
+}
+
+FTerrainTileCache::FTerrainTileCache(const FString& InRootDir, uint64 InParamsHash, int64 InMaxSizeBytes)
+	: RootDir(InRootDir)
+	, ParamsDir(FPaths::Combine(InRootDir, FString::Printf(TEXT("%016llx"), InParamsHash)))
+	, ParamsHash(InParamsHash)
+	, MaxSizeBytes(InMaxSizeBytes)
+{
+	struct FFoundTile {
+		FString Path;
+		int64 Size;
+		FDateTime LastUse;
+	};
+	TArray<FFoundTile> Found;
+	TArray<FString> StrayTemps;
+	IFileManager::Get().MakeDirectory(*ParamsDir, true);
+	IFileManager::Get().IterateDirectoryStatRecursively(*RootDir, [&](const TCHAR* Path, const FFileStatData& StatData) {
+		if (StatData.bIsDirectory) {
+			return true;
+		}
+		const FString Extension = FPaths::GetExtension(Path);
+		if (Extension == TEXT("tile")) {
+			Found.Add(FFoundTile{ Path, StatData.FileSize, StatData.ModificationTime });
+		}
+		else if (Extension == TEXT("tmp") && FString(Path).EndsWith(TEXT(".tile.tmp"))) {
+			// Left behind by a session that died between writing a tile and moving it in place
+			StrayTemps.Add(Path);
+		}
+		return true;
+	});
+	for (const FString& Path : StrayTemps) {
+		IFileManager::Get().Delete(*Path, false, false, true);
+	}
+
+	// `Load` stamps the files it reads, so their modification time is the LRU order of previous sessions
+	Found.Sort([](const FFoundTile& A, const FFoundTile& B) {
+		return A.LastUse < B.LastUse;
+	});
+	for (const FFoundTile& Tile : Found) {
+		Touch(Tile.Path, Tile.Size);
+	}
+
+	TArray<FString> Evicted;
+	{
+		FScopeLock ScopeLock(&Lock);
+		Evicted = CollectEvictions(FString());
+	}
+	DeleteEvicted(Evicted);
+}
+
+FString FTerrainTileCache::TilePath(FIntPoint ChunkCoord) const {
+	return FPaths::Combine(ParamsDir, FString::Printf(TEXT("%d_%d.tile"), ChunkCoord.X, ChunkCoord.Y));
+}
+
+bool FTerrainTileCache::Load(FIntPoint ChunkCoord, FQuantizedHeightfield& OutHeightField, FQuantizedApron& OutApron) {
+	const FString Path = TilePath(ChunkCoord);
+
+	TUniquePtr<IMappedFileHandle> Handle(FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*Path));
+	if (!Handle) {
+		FScopeLock ScopeLock(&Lock);
+		++Stats.Misses;
+		return false;
+	}
+
+	const int64 FileSize = Handle->GetFileSize();
+	bool bValid = false;
+	if (FileSize >= static_cast<int64>(sizeof(FTileHeader))) {
+		TUniquePtr<IMappedFileRegion> Region(Handle->MapRegion(0, FileSize));
+		if (Region) {
+			const uint8* Data = Region->GetMappedPtr();
+			FTileHeader Header;
+			FMemory::Memcpy(&Header, Data, sizeof(Header));
+
+			// Heightfield samples followed by the apron's
+			const int64 NumSamples = static_cast<int64>(Header.Width) * Header.Height;
+			const int64 PayloadSize = (NumSamples + FQuantizedApron::NumSamples(Header.Width, Header.Height)) * sizeof(uint16);
+			const uint8* Payload = Data + sizeof(FTileHeader);
+			bValid = Header.Magic == TileMagic
+				&& Header.Version == Version
+				&& Header.ParamsHash == ParamsHash
+				&& Header.ChunkX == ChunkCoord.X
+				&& Header.ChunkY == ChunkCoord.Y
+				&& Header.Width > 0
+				&& Header.Height > 0
+				&& Header.MaxHeight > Header.MinHeight
+				&& FileSize == sizeof(FTileHeader) + PayloadSize
+				&& FCrc::MemCrc32(Payload, PayloadSize) == Header.PayloadCrc;
+
+			if (bValid) {
+				OutHeightField.Width = Header.Width;
+				OutHeightField.Height = Header.Height;
+				OutHeightField.MinHeight = Header.MinHeight;
+				OutHeightField.MaxHeight = Header.MaxHeight;
+				OutHeightField.Samples.SetNumUninitialized(Header.Width * Header.Height);
+				FMemory::Memcpy(OutHeightField.Samples.GetData(), Payload, NumSamples * sizeof(uint16));
+				OutApron.Samples.SetNumUninitialized(FQuantizedApron::NumSamples(Header.Width, Header.Height));
+				FMemory::Memcpy(OutApron.Samples.GetData(), Payload + NumSamples * sizeof(uint16), OutApron.Samples.Num() * sizeof(uint16));
+			}
+		}
+	}
+	Handle.Reset();
+
+	if (!bValid) {
+		// Still on disk if it can't be deleted, so it stays accounted for until an eviction gets rid of it
+		if (IFileManager::Get().Delete(*Path, false, false, true)) {
+			Forget(Path);
+		}
+		FScopeLock ScopeLock(&Lock);
+		++Stats.Rejected;
+		++Stats.Misses;
+		return false;
+	}
+
+	// Persist the use, so LRU order survives restarts
+	IFileManager::Get().SetTimeStamp(*Path, FDateTime::UtcNow());
+	Touch(Path, FileSize);
+	FScopeLock ScopeLock(&Lock);
+	++Stats.Hits;
+	return true;
+}
+
+void FTerrainTileCache::Store(FIntPoint ChunkCoord, const FQuantizedHeightfield& HeightField, const FQuantizedApron& Apron) {
+	check(!HeightField.IsEmpty());
+	check(Apron.Samples.Num() == FQuantizedApron::NumSamples(HeightField.Width, HeightField.Height));
+
+	const int64 HeightFieldSize = HeightField.Samples.Num() * sizeof(uint16);
+	const int64 PayloadSize = HeightFieldSize + Apron.Samples.Num() * sizeof(uint16);
+	FTileHeader Header;
+	FMemory::Memzero(Header);
+	Header.Magic = TileMagic;
+	Header.Version = Version;
+	Header.ParamsHash = ParamsHash;
+	Header.ChunkX = ChunkCoord.X;
+	Header.ChunkY = ChunkCoord.Y;
+	Header.Width = HeightField.Width;
+	Header.Height = HeightField.Height;
+	Header.MinHeight = HeightField.MinHeight;
+	Header.MaxHeight = HeightField.MaxHeight;
+
+	TArray<uint8> Bytes;
+	Bytes.SetNumUninitialized(sizeof(FTileHeader) + PayloadSize);
+	uint8* Payload = Bytes.GetData() + sizeof(FTileHeader);
+	FMemory::Memcpy(Payload, HeightField.Samples.GetData(), HeightFieldSize);
+	FMemory::Memcpy(Payload + HeightFieldSize, Apron.Samples.GetData(), PayloadSize - HeightFieldSize);
+	Header.PayloadCrc = FCrc::MemCrc32(Payload, PayloadSize);
+	FMemory::Memcpy(Bytes.GetData(), &Header, sizeof(FTileHeader));
+
+	// Written next to the tile and moved in place, so readers never map a half written file
+	const FString Path = TilePath(ChunkCoord);
+	const FString TempPath = Path + TEXT(".tmp");
+	if (!FFileHelper::SaveArrayToFile(Bytes, *TempPath) || !IFileManager::Get().Move(*Path, *TempPath, true, true)) {
+		IFileManager::Get().Delete(*TempPath, false, false, true);
+		return;
+	}
+
+	Touch(Path, Bytes.Num());
+	TArray<FString> Evicted;
+	{
+		FScopeLock ScopeLock(&Lock);
+		++Stats.Writes;
+		Evicted = CollectEvictions(Path);
+	}
+	DeleteEvicted(Evicted);
+}
+
+FTerrainTileCacheStats FTerrainTileCache::GetStats() const {
+	FScopeLock ScopeLock(&Lock);
+	return Stats;
+}
+
+void FTerrainTileCache::Touch(const FString& Path, int64 Size) {
+	FScopeLock ScopeLock(&Lock);
+	FEntry* Entry = Entries.Find(Path);
+	if (!Entry) {
+		Entry = &Entries.Add(Path, FEntry());
+		Lru.AddTail(Path);
+		Entry->Node = Lru.GetTail();
+	}
+	else if (Entry->Node) {
+		Lru.RemoveNode(Entry->Node, false);
+		Lru.AddTail(Entry->Node);
+	}
+	else {
+		// Being evicted, the file goes anyway
+		EvictingBytes += Size - Entry->Size;
+	}
+	Stats.SizeBytes += Size - Entry->Size;
+	Entry->Size = Size;
+}
+
+void FTerrainTileCache::Forget(const FString& Path) {
+	FScopeLock ScopeLock(&Lock);
+	FEntry Entry;
+	if (Entries.RemoveAndCopyValue(Path, Entry)) {
+		Stats.SizeBytes -= Entry.Size;
+		if (Entry.Node) {
+			Lru.RemoveNode(Entry.Node);
+		}
+		else {
+			EvictingBytes -= Entry.Size;
+		}
+	}
+}
+
+TArray<FString> FTerrainTileCache::CollectEvictions(const FString& Keep) {
+	TArray<FString> Evicted;
+	while (Stats.SizeBytes - EvictingBytes > MaxSizeBytes) {
+		FLruList::TDoubleLinkedListNode* Oldest = Lru.GetHead();
+		// `Keep` was just touched, so it's only ever at the head when it's the last tile left
+		if (!Oldest || Oldest->GetValue() == Keep) {
+			break;
+		}
+
+		FEntry& Entry = Entries[Oldest->GetValue()];
+		Entry.Node = nullptr;
+		EvictingBytes += Entry.Size;
+		Evicted.Add(Oldest->GetValue());
+		Lru.RemoveNode(Oldest);
+	}
+	return Evicted;
+}
+
+void FTerrainTileCache::DeleteEvicted(const TArray<FString>& Paths) {
+	for (const FString& Path : Paths) {
+		const bool bDeleted = IFileManager::Get().Delete(*Path, false, false, true);
+
+		FScopeLock ScopeLock(&Lock);
+		FEntry* Entry = Entries.Find(Path);
+		if (!Entry) {
+			// Forgotten by a `Load` that rejected the file meanwhile
+			continue;
+		}
+		EvictingBytes -= Entry->Size;
+		if (bDeleted) {
+			Stats.SizeBytes -= Entry->Size;
+			++Stats.Evictions;
+			Entries.Remove(Path);
+		}
+		else {
+			Lru.AddHead(Path);
+			Entry->Node = Lru.GetHead();
+		}
+	}
+}
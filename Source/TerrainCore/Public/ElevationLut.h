@@ -0,0 +1,39 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Elevation curve sampled at a fixed resolution, so meshing never has to touch the curve (or any UObject).
+// Immutable once baked, safe to share between worker threads.
+class TERRAINCORE_API FElevationLut {
+public:
+	static constexpr int DefaultResolution = 256;
+
+	// Evaluates `Curve` at `Resolution` evenly spaced heights over `Domain`, scaled by `Multiplier`
+	void Bake(TFunctionRef<float(float)> Curve, FFloatInterval Domain, int Resolution, float Multiplier);
+
+	// Linear interpolation between the two nearest entries, heights outside the domain are clamped to it
+	FORCEINLINE float Sample(float Height) const {
+		const float T = FMath::Clamp((Height - DomainMin) * InvStep, 0.f, MaxIndex);
+		const int Index = static_cast<int>(T);
+		// The last entry is duplicated, so `Index + 1` is valid even at the top of the domain
+		const float* Entry = Values.GetData() + Index;
+		return FMath::Lerp(Entry[0], Entry[1], T - Index);
+	}
+
+	int GetResolution() const {
+		return Values.Num() - 1;
+	}
+
+	bool IsEmpty() const {
+		return Values.Num() == 0;
+	}
+
+	// Identifies the baked table, e.g. to tell whether precomputed elevations are still valid. Never zero.
+	uint64 GetHash() const;
+
+private:
+	TArray<float> Values;
+	float DomainMin = 0.;
+	float InvStep = 0.;
+	float MaxIndex = 0.;
+};
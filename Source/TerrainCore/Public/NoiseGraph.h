@@ -0,0 +1,112 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "NoiseMap.h"
+#include "ElevationLut.h"
+
+enum class ENoiseNodeOp : uint8 {
+	// fBm of one backend, scaled so its `FNoiseOctaves::GlobalBounds` map onto [-1, 1]
+	Source,
+	// 1 - 2|Input|, sharp crests where the input crosses zero
+	Ridged,
+	// 2|Input| - 1, rounded hills with sharp valleys
+	Billow,
+	// `Input` combined with `Other` by `BlendMode`
+	Blend,
+	// `Input` remapped through `Curve`
+	Curve,
+	Count
+};
+
+enum class ENoiseBlendMode : uint8 {
+	Add,
+	Multiply,
+	Min,
+	Max,
+	// Input to Other by `Alpha` remapped from [-1, 1] to [0, 1]
+	Lerp,
+	Count
+};
+
+struct FNoiseGraphNode {
+	ENoiseNodeOp Op = ENoiseNodeOp::Source;
+
+	// Source: sampled at `Frequency` times the terrain's frequency, seeded with the terrain's seed plus `SeedOffset`
+	ENoiseBackend Backend = ENoiseBackend::Perlin;
+	int SeedOffset = 0;
+	float Frequency = 1.;
+	int Octaves = 1;
+	float Persistance = 0.5;
+	float Lacunarity = 2.;
+	// Source: each sample is moved by (WarpX, WarpY) * WarpStrength unit spaced samples before sampling, either can
+	// be INDEX_NONE
+	int WarpX = INDEX_NONE;
+	int WarpY = INDEX_NONE;
+	float WarpStrength = 0.;
+
+	// Node indices read by the other ops, always earlier nodes
+	int Input = INDEX_NONE;
+	int Other = INDEX_NONE;
+	int Alpha = INDEX_NONE;
+	ENoiseBlendMode BlendMode = ENoiseBlendMode::Add;
+	// Baked over [-1, 1], see `NoiseGraph::CurveDomain`
+	FElevationLut Curve;
+
+	// Applied to the node's result last
+	float OutputScale = 1.;
+	float OutputBias = 0.;
+};
+
+// Nodes in evaluation order, every node only reads earlier ones and the last one is the height. Immutable once
+// built, safe to share between worker threads.
+class TERRAINCORE_API FNoiseGraph {
+public:
+	TArray<FNoiseGraphNode> Nodes;
+
+	bool IsEmpty() const {
+		return Nodes.Num() == 0;
+	}
+
+	// Whether every index points at an earlier node and every node has what its op reads
+	bool Validate(FString* OutError = nullptr) const;
+	// Over every parameter of every node, never zero
+	uint64 GetHash() const;
+};
+
+namespace NoiseGraph {
+	// What curve nodes are baked over, nodes roughly stay within it
+	inline FFloatInterval CurveDomain() {
+		return FFloatInterval(-1., 1.);
+	}
+}
+
+// `FNoiseOctaves` for a graph: the same row interface, so `NoiseMap` and `TerrainPipeline` take either. Rows are
+// pushed through the whole graph `TileWidth` samples at a time, so the only per node storage is one tile.
+class TERRAINCORE_API FNoiseGraphSampler {
+public:
+	static constexpr int TileWidth = 64;
+
+	// `Graph` has to be valid and outlive the sampler. `SampleSpacing` is the same as `FNoiseOctaves::Init`'s.
+	void Init(const FNoiseGraph& InGraph, int Seed, int InWidth, int InHeight, float Scale, FVector2D NoiseOffset, float InSampleSpacing = 1.);
+
+	void SumRow(ENoiseKernel Kernel, int Y, float* OutRow) const;
+	void SumColumns(ENoiseKernel Kernel, int Y, TArrayView<const int> Columns, float* Out) const;
+
+	// The graph's output is already normalized, a lone fBm source comes out the same as `FNoiseOctaves` would
+	FFloatInterval GlobalBounds() const {
+		return FFloatInterval(-1., 1.);
+	}
+
+	int Width = 0;
+	int Height = 0;
+	float SampleSpacing = 1.;
+
+private:
+	// `Count` samples of row `Y`, at `FirstX` onwards or at `Columns` if not null
+	void EvaluateTile(ENoiseKernel Kernel, int Y, int FirstX, const int* Columns, int Count, float* Scratch, float* Out) const;
+
+	const FNoiseGraph* Graph = nullptr;
+	// Indexed by node, only set up for sources
+	TArray<FNoiseOctaves> Sources;
+	TArray<float> SourceNormalizers;
+};
@@ -0,0 +1,73 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+enum class ENoiseKernel : uint8 {
+	// Per-sample `FMath::PerlinNoise2D`, what `NoiseMap` used to call directly
+	Reference,
+	Scalar,
+	SSE4,
+	AVX2,
+	Count
+};
+
+// What an octave samples, every backend returns roughly [-1, 1]
+enum class ENoiseBackend : uint8 {
+	// `FMath::PerlinNoise2D`, the only backend with SIMD kernels
+	Perlin,
+	// OpenSimplex2 on the A2* lattice, fewer axis aligned artifacts than Perlin
+	OpenSimplex2,
+	// Quintic interpolation of random lattice values, cheapest and blockiest
+	Value,
+	Count
+};
+
+// Every octave of one row of samples: octave O reads its X coordinates from `SampleXs + O * XStride` and
+// samples them all at `SampleYs[O]` with weight `Amplitudes[O]`
+struct FNoiseRowOctaves {
+	const float* SampleXs = nullptr;
+	int XStride = 0;
+	const float* SampleYs = nullptr;
+	const float* Amplitudes = nullptr;
+	int NumOctaves = 0;
+};
+
+// Every octave of a set of arbitrary sample positions: octave O samples (SampleXs[O * Stride + I], SampleYs[O * Stride + I])
+struct FNoisePointOctaves {
+	const float* SampleXs = nullptr;
+	const float* SampleYs = nullptr;
+	int Stride = 0;
+	const float* Amplitudes = nullptr;
+	int NumOctaves = 0;
+};
+
+// Batched noise, evaluating a whole row of samples at a time. The Perlin kernels reproduce
+// `FMath::PerlinNoise2D`: the gradient table is read back from the engine implementation, so the only
+// differences come from floating point contraction/ordering. OpenSimplex2 and value noise are scalar only.
+namespace NoiseKernel {
+	// Max absolute difference of an accumulated octave sum against `ENoiseKernel::Reference`
+	constexpr float Tolerance = 1e-5f;
+
+	TERRAINCORE_API bool IsSupported(ENoiseKernel Kernel);
+	TERRAINCORE_API ENoiseKernel BestSupported();
+	TERRAINCORE_API const TCHAR* ToString(ENoiseKernel Kernel);
+
+	// Octave counts up to this have a row loop specialized on the count: fully unrolled, with every octave of a
+	// sample summed in registers and the per octave row constants computed once up front
+	constexpr int MaxUnrolledOctaves = 8;
+
+	TERRAINCORE_API const TCHAR* ToString(ENoiseBackend Backend);
+
+	// Heights[I] += (Perlin(SampleX[I], SampleY) * 2 - 1) * Amplitude, for I in [0, Count)
+	TERRAINCORE_API void AccumulateOctaveRow(ENoiseKernel Kernel, const float* SampleX, float SampleY, float Amplitude, float* Heights, int Count);
+
+	// Heights[I] = Sum over octaves of Noise(SampleX, SampleY) * Amplitude, for I in [0, Count). Only Perlin has
+	// SIMD kernels, the other backends run their scalar kernel for anything but `Reference`. `Reference`, and
+	// octave counts above `MaxUnrolledOctaves`, make one pass over the row per octave instead.
+	TERRAINCORE_API void SumOctaveRow(ENoiseBackend Backend, ENoiseKernel Kernel, const FNoiseRowOctaves& Octaves, float* Heights, int Count);
+
+	// Same sum for samples that don't share a row, e.g. domain warped ones. Scalar kernel only.
+	TERRAINCORE_API void SumOctavePoints(ENoiseBackend Backend, const FNoisePointOctaves& Octaves, float* Heights, int Count);
+}
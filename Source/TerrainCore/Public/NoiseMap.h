@@ -0,0 +1,89 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Math/RandomStream.h"
+#include "NoiseKernel.h"
+
+class FNoiseGraph;
+
+enum class ENormalizeMode {
+	Local,
+	Global
+};
+
+enum class ENoiseThreading {
+	Serial,
+	// Rows are split into fixed size bands over worker threads, output is bit-identical to `Serial`
+	Parallel
+};
+
+// Per octave sample coordinates and amplitudes of a Width x Height map. `NoiseMap` and `TerrainPipeline`
+// both sum their rows from it, so they produce the same heights. Map sample (X, Y) lands on noise position
+// `NoiseOffset + (X, Y) * SampleSpacing`, so a coarser map covers more of the same noise with as many samples.
+struct TERRAINCORE_API FNoiseOctaves {
+	void Init(int Seed, int InWidth, int InHeight, float InScale, int Octaves, float Persistance, float Lacunarity, FVector2D NoiseOffset, ENoiseBackend InBackend = ENoiseBackend::Perlin, float InSampleSpacing = 1.);
+
+	// Unnormalized octave sum of row `Y`, `OutRow` has to hold `Width` values
+	void SumRow(ENoiseKernel Kernel, int Y, float* OutRow) const;
+	// Same for the `Columns.Num()` samples of row `Y` at `Columns`
+	void SumColumns(ENoiseKernel Kernel, int Y, TArrayView<const int> Columns, float* Out) const;
+	// Same for `Count` samples at fractional map positions (Xs[I], Ys[I]), which can be outside the map
+	void SumPoints(const float* Xs, const float* Ys, int Count, float* Out) const;
+
+	// What `ENormalizeMode::Global` normalizes against, known before any sample is computed
+	FFloatInterval GlobalBounds() const;
+
+	int Width = 0;
+	int Height = 0;
+	int NumOctaves = 0;
+	ENoiseBackend Backend = ENoiseBackend::Perlin;
+	float MaxPossibleHeight = 0.;
+	float Scale = 1.;
+	float SampleSpacing = 1.;
+	// Per octave random offset plus the map's noise offset, and frequency
+	TArray<FVector2D> Origins;
+	TArray<float> Frequencies;
+	// Octave major, [I * Width + X]
+	TArray<float> SampleXs;
+	// Row major, [Y * NumOctaves + I], so a row's octaves are contiguous
+	TArray<float> SampleYs;
+	TArray<float> Amplitudes;
+};
+
+class TERRAINCORE_API NoiseMap
+{
+public:
+	NoiseMap();
+	~NoiseMap();
+
+	void Init(ENormalizeMode NormalizeMode, int Seed, int Width, int Height, float Scale, int Octaves, float Persistance, float Lacunarity, FVector2D NoiseOffset, ENoiseThreading Threading = ENoiseThreading::Serial, ENoiseBackend Backend = ENoiseBackend::Perlin, float SampleSpacing = 1.);
+	// Same, with the heights coming out of a valid `Graph` instead of plain fBm
+	void Init(ENormalizeMode NormalizeMode, const FNoiseGraph& Graph, int Seed, int Width, int Height, float Scale, FVector2D NoiseOffset, ENoiseThreading Threading = ENoiseThreading::Serial, float SampleSpacing = 1.);
+
+	static constexpr int RowsPerBand = 16;
+
+	// Range normalized values can end up in. Local maps exactly onto [0, 1], Global can overshoot on both ends.
+	static FFloatInterval NormalizedRange(ENormalizeMode NormalizeMode);
+
+	// Where `V` lies between `X` and `Y`, shared with `TerrainPipeline` so both normalize the same way
+	static FORCEINLINE float InverseLerp(float X, float Y, float V) {
+		return (V - X) / (Y - X);
+	}
+
+	FRandomStream RandomStream;
+
+	TArray<float> NoiseValues;
+
+	int Width;
+	int Height;
+
+	float MinNoise;
+	float MaxNoise;
+
+private:
+	// Sums and normalizes every row of an initialized `FNoiseOctaves` or `FNoiseGraphSampler`
+	template<typename NoiseSourceType>
+	void Fill(ENormalizeMode NormalizeMode, const NoiseSourceType& NoiseOctaves, ENoiseThreading Threading);
+};
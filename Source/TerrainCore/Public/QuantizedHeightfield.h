@@ -0,0 +1,73 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FHeightApron;
+
+// Normalized heights stored as 16 bit over a fixed [MinHeight, MaxHeight] range, so everything derived from
+// the noise (meshes, textures) can be rebuilt after the float map and staging buffers are dropped.
+struct TERRAINCORE_API FQuantizedHeightfield {
+	int Width = 0;
+	int Height = 0;
+	float MinHeight = 0.;
+	float MaxHeight = 1.;
+	TArray<uint16> Samples;
+
+	// Heights outside the range are clamped
+	void Quantize(TArrayView<const float> Heights, int InWidth, int InHeight, FFloatInterval Range);
+	// Same as `Quantize`, for callers producing heights a few rows at a time: `Allocate` once, then
+	// `QuantizeRange` for each run of heights starting at sample `FirstSample`
+	void Allocate(int InWidth, int InHeight, FFloatInterval Range);
+	void QuantizeRange(int FirstSample, TArrayView<const float> Heights);
+	void Dequantize(TArray<float>& OutHeights) const;
+	// Sample `Height` is stored as, what `Quantize` writes for it
+	uint16 QuantizeSample(float Height) const;
+
+	float GetSample(int X, int Y) const {
+		return MinHeight + Samples[Y * Width + X] * GetStep();
+	}
+
+	float GetStep() const {
+		return (MaxHeight - MinHeight) / MAX_uint16;
+	}
+
+	bool IsEmpty() const {
+		return Samples.Num() == 0;
+	}
+
+	SIZE_T GetAllocatedSize() const {
+		return Samples.GetAllocatedSize();
+	}
+
+	void Reset() {
+		Samples.Empty();
+		Width = 0;
+		Height = 0;
+	}
+};
+
+// The one sample ring around a heightfield, quantized over that heightfield's range so it can be kept (and
+// cached) alongside it. Top and bottom rows of Width + 2 samples, then left and right columns of Height samples.
+struct TERRAINCORE_API FQuantizedApron {
+	TArray<uint16> Samples;
+
+	static int NumSamples(int Width, int Height) {
+		return 2 * (Width + 2) + 2 * Height;
+	}
+
+	// `Apron` has to be sized for `HeightField`
+	void Quantize(const FHeightApron& Apron, const FQuantizedHeightfield& HeightField);
+	void Dequantize(const FQuantizedHeightfield& HeightField, FHeightApron& OutApron) const;
+
+	bool IsEmpty() const {
+		return Samples.Num() == 0;
+	}
+
+	SIZE_T GetAllocatedSize() const {
+		return Samples.GetAllocatedSize();
+	}
+
+	void Reset() {
+		Samples.Empty();
+	}
+};
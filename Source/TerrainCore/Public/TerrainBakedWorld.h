@@ -0,0 +1,120 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "QuantizedHeightfield.h"
+#include <atomic>
+
+class IFileHandle;
+class IMappedFileHandle;
+class IMappedFileRegion;
+
+// What a baked world file covers and which parameters it was baked with
+struct FBakedWorldDesc {
+	// Hash of everything the heightfields depend on, see `AEndlessTerrain::GenerationParamsHash`
+	uint64 ParamsHash = 0;
+	// `FTerrainClassifier::GetHash`, zero if no classification was baked
+	uint64 ClassifierHash = 0;
+	// `FElevationLut::GetHash`, zero if no mesh Lods were baked
+	uint64 ElevationHash = 0;
+	// Chunk coordinates, Max exclusive
+	FIntRect ChunkRect;
+	// Samples per chunk side
+	int ChunkSamples = 0;
+	// Step sizes of the baked mesh Lods, elevations are stored per decimated vertex
+	TArray<int> LodSteps;
+
+	bool HasClasses() const {
+		return ClassifierHash != 0;
+	}
+
+	int NumChunks() const {
+		return ChunkRect.Area();
+	}
+};
+
+namespace TerrainBakedWorld {
+	// Bumped whenever the file layout changes
+	constexpr uint32 Version = 2;
+
+	// Bytes of one chunk record, the same for every chunk of a file
+	TERRAINCORE_API int64 RecordSize(const FBakedWorldDesc& Desc);
+}
+
+// Per chunk record: the quantized heightfield and its apron, one layer index per sample and the vertex elevations
+// of every Lod
+struct FBakedChunk {
+	FQuantizedHeightfield HeightField;
+	FQuantizedApron Apron;
+	TArray<uint8> Classes;
+	// Same order as `FBakedWorldDesc::LodSteps`
+	TArray<TArray<float>> LodElevations;
+};
+
+// Streams a baked world to disk: header, chunk records in any order, then the index. Single threaded.
+class TERRAINCORE_API FBakedWorldWriter {
+public:
+	FBakedWorldWriter(const FString& Path, const FBakedWorldDesc& Desc);
+	~FBakedWorldWriter();
+
+	bool IsValid() const {
+		return File.IsValid();
+	}
+
+	// Every chunk of `ChunkRect` has to be added exactly once before `Finish`
+	bool Add(FIntPoint ChunkCoord, const FBakedChunk& Chunk);
+	bool Finish();
+
+private:
+	struct FIndexEntry {
+		uint64 Offset = 0;
+		uint32 Size = 0;
+		uint32 Crc = 0;
+	};
+
+	FBakedWorldDesc Desc;
+	TUniquePtr<IFileHandle> File;
+	TArray<FIndexEntry> Index;
+	TArray<uint8> Scratch;
+};
+
+// Memory maps a baked world. Read only once opened, so it can be shared between worker threads.
+class TERRAINCORE_API FBakedWorldReader {
+public:
+	FBakedWorldReader();
+	~FBakedWorldReader();
+
+	// Fails on missing, truncated or outdated files
+	bool Open(const FString& Path);
+
+	const FBakedWorldDesc& GetDesc() const {
+		return Desc;
+	}
+
+	bool Contains(FIntPoint ChunkCoord) const {
+		return Desc.ChunkRect.Contains(ChunkCoord);
+	}
+
+	// All false if the chunk isn't baked or its record fails its CRC
+	bool ReadHeightField(FIntPoint ChunkCoord, FQuantizedHeightfield& OutHeightField, FQuantizedApron& OutApron) const;
+	bool ReadClasses(FIntPoint ChunkCoord, TArray<uint8>& OutClasses) const;
+	bool ReadLodElevations(FIntPoint ChunkCoord, int LodStep, TArray<float>& OutElevations) const;
+
+private:
+	// Start of the chunk's record, null if it's missing or fails its CRC. The CRC only runs on the first lookup.
+	const uint8* FindRecord(FIntPoint ChunkCoord) const;
+
+	enum class ERecordState : uint8 {
+		Unchecked,
+		Valid,
+		Corrupt
+	};
+
+	FBakedWorldDesc Desc;
+	TUniquePtr<IMappedFileHandle> Handle;
+	TUniquePtr<IMappedFileRegion> Region;
+	const uint8* Data = nullptr;
+	int64 DataSize = 0;
+	int64 IndexOffset = 0;
+	// `ERecordState` per chunk, filled in by whichever thread reads the record first
+	TUniquePtr<std::atomic<ERecordState>[]> RecordStates;
+};
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "NoiseKernel.h"
+
+struct FTerrainBenchmarkConfig {
+	// Samples per chunk side, (Size - 1) has to be divisible by every step in `StepSizes`
+	TArray<int> ChunkSizes = { 121, 241, 481 };
+	TArray<int> Octaves = { 1, 4, 8 };
+	// Only the noise stage runs per backend
+	TArray<ENoiseBackend> Backends = { ENoiseBackend::Perlin, ENoiseBackend::OpenSimplex2, ENoiseBackend::Value };
+	// `EMapLod` values
+	TArray<int> StepSizes = { 1, 2, 4, 6, 8, 10, 12 };
+	int Iterations = 4;
+};
+
+struct FTerrainBenchmarkResult {
+	FString Stage;
+	int ChunkSize;
+	int Octaves;
+	int StepSize;
+	double ItemsPerSecond;
+	// "samples", "vertices" or "texels"
+	const TCHAR* Unit;
+};
+
+namespace TerrainBenchmark {
+	// Per-kernel throughput and max error of `NoiseKernel` against the FMath reference
+	TERRAINCORE_API void RunNoiseKernels(int Width, int Octaves, int Iterations);
+
+	// Per backend and octave count: throughput of the octave-unrolled row kernel against one pass per octave,
+	// its max error against that, and the value range and axis vs diagonal smoothness of the summed noise
+	TERRAINCORE_API void RunNoiseBackends(int Width, int Iterations);
+
+	// Noise (samples/sec) per chunk size, octave count and backend, meshing (vertices/sec) per chunk size and step,
+	// texturing (texels/sec) per chunk size, and the multi-pass chunk generation against `TerrainPipeline`
+	// (samples/sec) per chunk size, octave count and normalize mode, plus `TerrainPipeline` on an 8 node graph
+	TERRAINCORE_API TArray<FTerrainBenchmarkResult> RunSuite(const FTerrainBenchmarkConfig& Config);
+	TERRAINCORE_API void LogResults(const TArray<FTerrainBenchmarkResult>& Results);
+}
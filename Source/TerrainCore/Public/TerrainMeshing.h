@@ -0,0 +1,63 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ElevationLut.h"
+#include "QuantizedHeightfield.h"
+
+// A Width x Height grid of height samples, meshed every `StepSize` samples
+struct FTerrainGrid {
+	int Width;
+	int Height;
+	int StepSize;
+	float TileSize;
+	// World position of sample (0, 0), Z is added to every elevation
+	FVector Origin;
+
+	int VerticesPerRow() const {
+		return (Width - 1) / StepSize + 1;
+	}
+
+	int VerticesPerColumn() const {
+		return (Height - 1) / StepSize + 1;
+	}
+
+	int NumVertices() const {
+		return VerticesPerRow() * VerticesPerColumn();
+	}
+
+	int NumIndices() const {
+		return (VerticesPerRow() - 1) * (VerticesPerColumn() - 1) * 6;
+	}
+};
+
+// Heights of the one sample ring around a Width x Height grid, so normals on the grid's border see the same
+// neighbors the adjacent grid has
+struct FHeightApron {
+	// Width + 2 samples each, x = -1 to x = Width, at y = -1 and y = Height
+	TArray<float> Top;
+	TArray<float> Bottom;
+	// Height samples each, y = 0 to y = Height - 1, at x = -1 and x = Width
+	TArray<float> Left;
+	TArray<float> Right;
+
+	bool IsEmpty() const {
+		return Top.Num() == 0;
+	}
+};
+
+namespace TerrainMeshing {
+	// One vertex every `StepSize` samples, `Elevation` maps a normalized height to the vertex Z
+	TERRAINCORE_API void BuildVertices(const FTerrainGrid& Grid, TArrayView<const float> Heights, const FElevationLut& Elevation, TArray<FVector>& Vertices, TArray<FVector2D>& Uv0);
+	// Row `Y` of `BuildVertices` (which has to be a multiple of `StepSize`) from that row's `Width` heights, written to
+	// vertex `Y / StepSize * VerticesPerRow()` onwards of arrays already sized to `NumVertices()`
+	TERRAINCORE_API void BuildVertexRow(const FTerrainGrid& Grid, int Y, const float* RowHeights, const FElevationLut& Elevation, FVector* Vertices, FVector2D* Uv0);
+	// Just the vertex Z of `BuildVertices`, row by row
+	TERRAINCORE_API void BuildElevations(const FTerrainGrid& Grid, TArrayView<const float> Heights, const FElevationLut& Elevation, TArray<float>& Elevations);
+	// `BuildVertices` from elevations computed up front by `BuildElevations`
+	TERRAINCORE_API void BuildVerticesFromElevations(const FTerrainGrid& Grid, TArrayView<const float> Elevations, TArray<FVector>& Vertices, TArray<FVector2D>& Uv0);
+	// Per vertex normal and tangent (X axis) from central differences of the elevation over neighboring samples,
+	// independent of `StepSize` so Lods agree. Falls back to one sided differences on the border if `Apron` is empty.
+	TERRAINCORE_API void BuildNormals(const FTerrainGrid& Grid, const FQuantizedHeightfield& HeightField, const FHeightApron& Apron, const FElevationLut& Elevation, TArray<FVector>& Normals, TArray<FVector>& Tangents);
+	// Two counter-clockwise triangles per quad of the decimated vertex grid
+	TERRAINCORE_API void BuildTriangles(const FTerrainGrid& Grid, TArray<int32>& Triangles);
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "NoiseMap.h"
+#include "NoiseGraph.h"
+#include "ElevationLut.h"
+#include "TerrainMeshing.h"
+#include "TerrainTexturing.h"
+#include "QuantizedHeightfield.h"
+
+enum class EPipelineTexels : uint8 {
+	None,
+	// `TerrainTexturing::WriteColors`
+	Color,
+	// `TerrainTexturing::WriteIndices`
+	PaletteIndex
+};
+
+// Everything `TerrainPipeline::BuildChunk` needs, the noise parameters are the ones `NoiseMap::Init` takes
+struct FChunkPipelineDesc {
+	ENormalizeMode NormalizeMode = ENormalizeMode::Global;
+	int Seed = 0;
+	float Scale = 1.;
+	int Octaves = 1;
+	float Persistance = 0.5;
+	float Lacunarity = 1.;
+	FVector2D NoiseOffset = FVector2D(0., 0.);
+	// Noise samples between two grid samples, see `FNoiseOctaves::Init`
+	float SampleSpacing = 1.;
+	ENoiseThreading Threading = ENoiseThreading::Serial;
+	ENoiseBackend Backend = ENoiseBackend::Perlin;
+	// Replaces the fBm parameters above when set, `Seed`, `Scale` and `NoiseOffset` still apply
+	const FNoiseGraph* Graph = nullptr;
+
+	// Width and Height are the noise dimensions as well
+	FTerrainGrid Grid;
+	const FElevationLut* Elevation = nullptr;
+	// Only read if `Texels` isn't `None`
+	const FTerrainClassifier* Classifier = nullptr;
+	EPipelineTexels Texels = EPipelineTexels::None;
+};
+
+struct FChunkPipelineOutput {
+	// Over `NoiseMap::NormalizedRange(NormalizeMode)`
+	FQuantizedHeightfield HeightField;
+	TArray<FVector> Vertices;
+	TArray<FVector2D> Uv0;
+	TArray<uint8> Texels;
+	// Whether any texel was classified into a water layer, always false without texels
+	bool bHasWater = false;
+};
+
+// Noise -> normalize -> quantize -> texel -> vertex, one band of rows at a time so each row is consumed by every
+// stage while it's still in cache. Produces exactly what `NoiseMap::Init` followed by `Quantize`, the texturing
+// functions and `TerrainMeshing::BuildVertices` would, without keeping the float map around.
+namespace TerrainPipeline {
+	constexpr int RowsPerBand = NoiseMap::RowsPerBand;
+
+	// Global normalization bounds are known up front, so that is a single pass over the noise. Local needs the
+	// noise's min and max first, so the raw noise is summed in a first pass and the rest fused into a second.
+	TERRAINCORE_API void BuildChunk(const FChunkPipelineDesc& Desc, FChunkPipelineOutput& Out);
+
+	// The one sample ring around the chunk straight from the noise function, which is what the neighboring chunks
+	// compute for their own samples there. Quantized like `HeightField`, so both sides of a border agree on the
+	// heights their normals are built from. Global normalize mode only, Local bounds differ per chunk.
+	// Only `Grid.Width` and `Grid.Height` of `Desc.Grid` are read.
+	TERRAINCORE_API void BuildApron(const FChunkPipelineDesc& Desc, const FQuantizedHeightfield& HeightField, FQuantizedApron& Out);
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Engine-free mirror of `FTerrainParams`: every height <= MaxHeight (and above the previous layer) gets Color
+struct FTerrainLayer {
+	float MaxHeight;
+	FColor Color;
+	// Samples classified into it get a water surface over them
+	bool bWater = false;
+};
+
+// Maps a height to its layer index through a fixed grid of cells over `Domain`. Each cell keeps the layer at its
+// lower edge plus that layer's MaxHeight, so a single compare resolves a boundary falling inside the cell.
+// Exact as long as no layer is thinner than a cell.
+class TERRAINCORE_API FTerrainClassifier {
+public:
+	static constexpr int DefaultResolution = 1024;
+
+	void Build(TArrayView<const FTerrainLayer> Layers, FFloatInterval Domain, int Resolution = DefaultResolution);
+
+	// Heights above every layer get `NumLayers()`
+	FORCEINLINE uint8 Classify(float Height) const {
+		const float T = FMath::Clamp((Height - DomainMin) * InvCellSize, 0.f, MaxCell);
+		const int Cell = static_cast<int>(T);
+		return CellLayers.GetData()[Cell] + static_cast<uint8>(Height > CellBoundaries.GetData()[Cell]);
+	}
+
+	FORCEINLINE bool IsWater(uint8 Layer) const {
+		return WaterLayers.GetData()[Layer] != 0;
+	}
+
+	int NumLayers() const {
+		return Palette.Num() - 1;
+	}
+
+	// One color per layer, plus transparent black for heights above every layer
+	const TArray<FColor>& GetPalette() const {
+		return Palette;
+	}
+
+	bool IsEmpty() const {
+		return CellLayers.Num() == 0;
+	}
+
+	// Identifies the classification and palette, e.g. to tell whether baked layer indices are still valid. Never zero.
+	uint64 GetHash() const;
+
+private:
+	TArray<uint8> CellLayers;
+	TArray<float> CellBoundaries;
+	TArray<FColor> Palette;
+	// Per layer index, including the one above every layer
+	TArray<uint8> WaterLayers;
+	float DomainMin = 0.;
+	float InvCellSize = 0.;
+	float MaxCell = 0.;
+};
+
+namespace TerrainTexturing {
+	// Color textures are PF_B8G8R8A8
+	constexpr int BytesPerTexel = 4;
+	// Index textures are PF_G8, resolved against the classifier's palette in the material
+	constexpr int BytesPerIndexTexel = 1;
+	// Width of the palette texture. Index textures store the raw layer index, which the material samples as
+	// Index / 255 and looks up at U = (Sample * 255 + 0.5) / PaletteTextureWidth
+	constexpr int PaletteTextureWidth = 256;
+
+	// The classifying writers return whether any sample landed in a water layer
+	TERRAINCORE_API bool WriteColors(TArrayView<const float> Heights, const FTerrainClassifier& Classifier, uint8* OutTexels);
+	// Colors of layer indices classified up front
+	TERRAINCORE_API bool WriteColorsFromIndices(TArrayView<const uint8> Indices, const FTerrainClassifier& Classifier, uint8* OutTexels);
+	TERRAINCORE_API bool WriteIndices(TArrayView<const float> Heights, const FTerrainClassifier& Classifier, uint8* OutTexels);
+	// Whether any of the layer indices classified up front is a water layer
+	TERRAINCORE_API bool HasWater(TArrayView<const uint8> Indices, const FTerrainClassifier& Classifier);
+	TERRAINCORE_API void WriteGrayscale(TArrayView<const float> Heights, uint8* OutTexels);
+	// `PaletteTextureWidth` BGRA texels, entries past the palette are transparent black
+	TERRAINCORE_API void WritePalette(const FTerrainClassifier& Classifier, uint8* OutTexels);
+}
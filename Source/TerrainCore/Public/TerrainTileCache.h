@@ -0,0 +1,69 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/List.h"
+#include "QuantizedHeightfield.h"
+
+struct FTerrainTileCacheStats {
+	int64 Hits = 0;
+	int64 Misses = 0;
+	// Tiles found on disk but thrown away, because they were truncated, failed their CRC or belong to other parameters
+	int64 Rejected = 0;
+	int64 Writes = 0;
+	int64 Evictions = 0;
+	int64 SizeBytes = 0;
+};
+
+// On-disk cache of chunk heightfields and their aprons, one memory mapped file per chunk under `<RootDir>/<ParamsHash>/X_Y.tile`.
+// Tiles of every parameter set share the size cap, the least recently used ones are deleted first.
+// `Load` and `Store` can be called from any thread.
+class TERRAINCORE_API FTerrainTileCache {
+public:
+	// Bumped whenever the tile layout or anything feeding the heightfield changes
+	static constexpr uint32 Version = 2;
+
+	// Scans `RootDir` for existing tiles, `ParamsHash` has to cover everything the heightfield depends on
+	FTerrainTileCache(const FString& RootDir, uint64 ParamsHash, int64 MaxSizeBytes);
+
+	// False on a miss, or if the tile on disk can't be trusted, in which case it's deleted
+	bool Load(FIntPoint ChunkCoord, FQuantizedHeightfield& OutHeightField, FQuantizedApron& OutApron);
+	void Store(FIntPoint ChunkCoord, const FQuantizedHeightfield& HeightField, const FQuantizedApron& Apron);
+
+	FTerrainTileCacheStats GetStats() const;
+
+	uint64 GetParamsHash() const {
+		return ParamsHash;
+	}
+
+private:
+	typedef TDoubleLinkedList<FString> FLruList;
+
+	struct FEntry {
+		int64 Size = 0;
+		// Position in `Lru`, null while the file is being evicted
+		FLruList::TDoubleLinkedListNode* Node = nullptr;
+	};
+
+	FString TilePath(FIntPoint ChunkCoord) const;
+	void Touch(const FString& Path, int64 Size);
+	void Forget(const FString& Path);
+	// Caller holds `Lock`. Takes the least recently used files off `Lru` until the ones left fit the cap, they stay
+	// accounted for until `DeleteEvicted` actually removes them.
+	TArray<FString> CollectEvictions(const FString& Keep);
+	// Without `Lock` held. Files that can't be deleted, say because another worker has them mapped, go back to the
+	// front of `Lru` to be retried by the next eviction.
+	void DeleteEvicted(const TArray<FString>& Paths);
+
+	FString RootDir;
+	FString ParamsDir;
+	uint64 ParamsHash;
+	int64 MaxSizeBytes;
+
+	mutable FCriticalSection Lock;
+	TMap<FString, FEntry> Entries;
+	// Least recently used first
+	FLruList Lru;
+	// Size of the files collected for eviction but not deleted yet
+	int64 EvictingBytes = 0;
+	FTerrainTileCacheStats Stats;
+};
@@ -0,0 +1,13 @@
+using UnrealBuildTool;
+
+// Engine-light terrain math (noise, meshing, texturing), only depends on Core so it can be linked into
+// headless programs like TerrainBenchmark as well as the game module.
+public class TerrainCore : ModuleRules
+{
+	public TerrainCore(ReadOnlyTargetRules Target) : base(Target)
+	{
+		PCHUsage = PCHUsageMode.UseExplicitOrSharedPCHs;
+
+		PublicDependencyModuleNames.AddRange(new string[] { "Core" });
+	}
+}